@@ -0,0 +1,362 @@
+/*
+ -------------------------------------
+ File:    bench.c
+ Project: conway-game-of-life
+ Benchmark suite for the update engines (separate program, not part of the game)
+ Build:   gcc -O2 -o bench src/bench.c src/life_functions.c src/rules.c src/worker_pool.c src/hashlife.c src/cycle.c src/sparse.c src/checkpoint.c src/perf.c src/gen_stats.c src/pacer.c src/recorder.c src/history.c -lncurses -lpthread
+ -------------------------------------
+ Author:  Akshath Wikramanayake
+ Email:   akshath.wikramanayake@gmail.com
+ Version  0.0.1
+ -------------------------------------
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <unistd.h>
+#ifdef _WIN32
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+#include "life_functions.h"
+#include "worker_pool.h"
+#include "hashlife.h"
+#include "sparse.h"
+#include "rules.h"
+
+
+static const char* gosper_gun[] = {
+    "........................O...........",
+    "......................O.O...........",
+    "............OO......OO............OO",
+    "...........O...O....OO............OO",
+    "OO........O.....O...OO..............",
+    "OO........O...O.OO....O.O...........",
+    "..........O.....O.......O...........",
+    "...........O...O....................",
+    "............OO......................",
+    0
+};
+
+static const char* simkin_gun[] = {
+    "OO.....OO........................",
+    "OO.....OO........................",
+    ".................................",
+    "....OO...........................",
+    "....OO...........................",
+    ".................................",
+    ".................................",
+    ".................................",
+    ".................................",
+    "......................OO.OO......",
+    ".....................O.....O.....",
+    ".....................O......O..OO",
+    ".....................OOO...O...OO",
+    "..........................O......",
+    ".................................",
+    ".................................",
+    ".................................",
+    "....................OO...........",
+    "....................O............",
+    ".....................OOO.........",
+    ".......................O.........",
+    0
+};
+
+
+typedef struct _bench_init {
+    const char* name;           // name reported in the results
+    double density;             // random fill density (used when pattern is NULL)
+    const char** pattern;       // pattern placed in the top-left quarter of the board
+} bench_init;
+
+static const bench_init inits[] = {
+    { "random-0.05", 0.05, 0 },
+    { "random-0.25", 0.25, 0 },
+    { "random-0.50", 0.50, 0 },
+    { "gosper-gun", 0, gosper_gun },
+    { "simkin-gun", 0, simkin_gun },
+};
+
+static const char* engine_names[] = { "bitwise", "naive", "hashlife", "sparse", "lut" };
+static const char* kernel_names[] = { "life", "table" };
+
+
+/*
+    Peak resident memory of the process in KiB
+*/
+static
+size_t peak_memory_kb(void) {
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS pmc;
+    GetProcessMemoryInfo(GetCurrentProcess(), &pmc, sizeof(pmc));
+    return pmc.PeakWorkingSetSize / 1024;
+#else
+    struct rusage ru;
+    getrusage(RUSAGE_SELF, &ru);
+    return ru.ru_maxrss;
+#endif
+}
+
+
+static
+void place_pattern(board* B, const char** pattern, size_t y0, size_t x0) {
+    for (size_t i = 0; pattern[i]; i++) {
+        for (size_t j = 0; pattern[i][j]; j++) {
+            if (pattern[i][j] == 'O' && y0 + i < B->n_rows && x0 + j < B->n_cols) {
+                set_cell(B, y0 + i, x0 + j, true);
+            }
+        }
+    }
+}
+
+
+/*
+    Sets up a game for one benchmark configuration
+*/
+static
+void setup(game_state* G, size_t engine, size_t size, bool toroidal, const bench_init* init, size_t threads, const life_rule* rule,
+           size_t block) {
+    init_game(G, size, size, SIZE_MAX, toroidal);
+    G->engine = engine;
+    G->rule = *rule;
+    if (engine == ENGINE_BITWISE) {
+        G->gens_per_update = block;                                 // temporal blocking
+    }
+    if (engine == ENGINE_HASHLIFE) {
+        G->hl = create_hashlife((size_t)512 << 20, rule);
+    } else if (engine == ENGINE_SPARSE) {
+        G->sparse = create_sparse_grid(rule);
+    } else if (threads > 1) {
+        size_t bands = size / TILE_ROWS ? size / TILE_ROWS : 1;     // at least 1 tile row per band
+        G->pool = create_pool(threads < bands ? threads : bands);
+    }
+    if (init->pattern) {
+        place_pattern(G->B, init->pattern, size / 4, size / 4);
+    } else {
+        board_randomise(G->B, init->density, 12345);
+    }
+    game_start(G);
+}
+
+
+static
+int compare_doubles(const void* a, const void* b) {
+    double x = *(const double*)a;
+    double y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+
+/*
+    Checks an engine against the naive engine on a few random boards (both under the given rule)
+    block: generations per update of the bitwise engine (temporal blocking), compared every block generations
+    returns: true if every board matched after every generation and stepping made no heap allocations (the
+             sparse engine allocates the chunks the pattern grows into, it is exempt)
+*/
+static
+bool check_engine(size_t engine, size_t threads, const life_rule* rule, size_t block) {
+    const size_t sizes[][2] = { { 97, 131 }, { 64, 64 }, { 150, 70 } };
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+        for (int toroidal = 0; toroidal < 2; toroidal++) {
+            bool unbounded = (engine == ENGINE_HASHLIFE || engine == ENGINE_SPARSE);
+            if (unbounded && toroidal) {
+                continue;                                           // Hashlife and the sparse grid simulate an unbounded plane
+            }
+            game_state ref, G;
+            init_game(&ref, sizes[s][0], sizes[s][1], SIZE_MAX, toroidal);
+            init_game(&G, sizes[s][0], sizes[s][1], SIZE_MAX, toroidal);
+            ref.engine = ENGINE_NAIVE;
+            G.engine = engine;
+            ref.rule = *rule;
+            G.rule = *rule;
+            if (engine == ENGINE_HASHLIFE) {
+                G.hl = create_hashlife((size_t)64 << 20, rule);
+            } else if (engine == ENGINE_SPARSE) {
+                G.sparse = create_sparse_grid(rule);
+            } else if (threads > 1) {
+                G.pool = create_pool(threads);
+            }
+            size_t step = (engine == ENGINE_BITWISE) ? block : 1;
+            G.gens_per_update = step;
+            board_randomise(ref.B, 0.3, s + 1);
+            if (unbounded) {                                        // keep the soup away from the walls
+                memset(ref.B->data, 0, (ref.B->n_rows + 2) * ref.B->stride * sizeof(uint64_t));
+                for (size_t i = 0; i < 16; i++) {
+                    for (size_t j = 0; j < 16; j++) {
+                        set_cell(ref.B, sizes[s][0] / 2 + i - 8, sizes[s][1] / 2 + j - 8, (i * 7 + j * 13 + s) % 3 == 0);
+                    }
+                }
+            }
+            board_copy(G.B, ref.B);
+            game_start(&ref);
+            game_start(&G);
+
+            size_t gens = unbounded ? 20 : 200;
+            bool ok = true;
+            size_t allocs = 0;                                      // heap allocations made by the engine under test
+            for (size_t g = 0; g < gens && ok; g += step) {
+                int c_ref = 0;
+                for (size_t k = 0; k < step; k++) {
+                    c_ref = game_update(&ref);                      // the last generation of the update
+                }
+                size_t a0 = game_alloc_count();
+                int c = game_update(&G);
+                allocs += game_alloc_count() - a0;
+                ok = board_equal(ref.B, G.B) && (c == c_ref)
+                  && (unbounded || G.hash == board_hash(G.B));      // the unbounded engines hash the whole universe
+            }
+            destroy_game(&ref);
+            destroy_game(&G);
+            if (!ok) {
+                fprintf(stderr, "check failed: engine %s, %zux%zu, %s, %zu generations per update\n", engine_names[engine],
+                        sizes[s][0], sizes[s][1], toroidal ? "toroidal" : "walled", step);
+                return false;
+            }
+            if (allocs && engine != ENGINE_SPARSE) {                // the boards are double-buffered: stepping must not allocate
+                fprintf(stderr, "check failed: engine %s, %zux%zu, %s, %zu heap allocations while stepping\n", engine_names[engine],
+                        sizes[s][0], sizes[s][1], toroidal ? "toroidal" : "walled", allocs);
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+
+static
+void usage(const char* prog) {
+    fprintf(stderr, "usage: %s [-o file] [-l label] [-n min] [-x max] [-t threads] [-r trials] [-w warmup] [-c cells] [-e engine] [-b rule] [-T] [-g gens] [-h]\n", prog);
+    fprintf(stderr, "  -o file     write the results to file (default: stdout)\n");
+    fprintf(stderr, "  -l label    label written in every result row (e.g. the commit being measured)\n");
+    fprintf(stderr, "  -n/-x size  smallest/largest board side (default 64 / 16384, doubling)\n");
+    fprintf(stderr, "  -t threads  worker threads for the bitwise, naive and lut engines (default 1)\n");
+    fprintf(stderr, "  -r trials   timed trials per configuration (default 5, the median is reported)\n");
+    fprintf(stderr, "  -w warmup   untimed warm-up generations per configuration (default 8)\n");
+    fprintf(stderr, "  -c cells    cell updates per trial, sets the # of generations (default 2^28)\n");
+    fprintf(stderr, "  -e engine   only benchmark this engine (bitwise, naive, hashlife, sparse or lut)\n");
+    fprintf(stderr, "  -b rule     birth/survival rule (default B3/S23)\n");
+    fprintf(stderr, "  -T          use the table kernel even for B3/S23 (measures what the hardcoded Life kernel saves)\n");
+    fprintf(stderr, "  -g gens     generations per update of the bitwise engine (temporal blocking, default 1)\n");
+    fprintf(stderr, "  -h          print this help\n");
+}
+
+
+int main(int argc, char* argv[argc+1]) {
+    FILE* out = stdout;
+    const char* label = "";
+    size_t min_size = 64;
+    size_t max_size = 16384;
+    size_t threads = 1;
+    size_t trials = 5;
+    size_t warmup = 8;
+    double cells_per_trial = (double)(1u << 28);
+    int only_engine = -1;
+    life_rule rule;
+    rule_init(&rule, RULE_LIFE_BIRTH, RULE_LIFE_SURVIVE);
+    bool force_table = false;
+    size_t block = 1;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "o:l:n:x:t:r:w:c:e:b:Tg:h")) != -1) {
+        switch (opt) {
+        case 'o' : out = fopen(optarg, "w"); if (!out) { perror(optarg); return EXIT_FAILURE; } break;
+        case 'l' : label = optarg; break;
+        case 'n' : min_size = strtoull(optarg, 0, 0); break;
+        case 'x' : max_size = strtoull(optarg, 0, 0); break;
+        case 't' : threads = strtoull(optarg, 0, 0); break;
+        case 'r' : trials = strtoull(optarg, 0, 0); break;
+        case 'w' : warmup = strtoull(optarg, 0, 0); break;
+        case 'c' : cells_per_trial = strtod(optarg, 0); break;
+        case 'e' :
+            for (size_t e = 0; e < sizeof(engine_names) / sizeof(engine_names[0]); e++) {
+                if (!strcmp(optarg, engine_names[e])) only_engine = e;
+            }
+            if (only_engine < 0) { usage(argv[0]); return EXIT_FAILURE; }
+            break;
+        case 'b' : if (!parse_rule(optarg, &rule)) { usage(argv[0]); return EXIT_FAILURE; } break;
+        case 'T' : force_table = true; break;
+        case 'g' : block = strtoull(optarg, 0, 0); if (!block) block = 1; break;
+        case 'h' : usage(argv[0]); return EXIT_SUCCESS;
+        default : usage(argv[0]); return EXIT_FAILURE;
+        }
+    }
+    if (trials == 0) trials = 1;
+    if (force_table) {
+        rule.kernel = KERNEL_TABLE;                                 // the table kernel computes any rule, Life included
+    }
+    char rule_str[32];
+    rule_name(&rule, rule_str, sizeof(rule_str));
+
+    for (size_t e = 0; e < sizeof(engine_names) / sizeof(engine_names[0]); e++) {   // correctness first
+        if ((only_engine < 0 || (size_t)only_engine == e) && e != ENGINE_NAIVE && !check_engine(e, threads, &rule, block)) {
+            return EXIT_FAILURE;
+        }
+    }
+
+    fprintf(out, "label,engine,rule,kernel,block,geometry,rows,cols,init,threads,generations,trials,median_s,min_s,cells_per_s,ns_per_cell,peak_rss_kb\n");
+    double* times = malloc(trials * sizeof(double));
+
+    for (size_t size = min_size; size <= max_size; size *= 2) {    // increasing sizes: the peak RSS tracks the current size
+        for (size_t e = 0; e < sizeof(engine_names) / sizeof(engine_names[0]); e++) {
+            if ((only_engine >= 0 && (size_t)only_engine != e) || (e == ENGINE_NAIVE && size > 2048 && only_engine < 0)) {
+                continue;                                           // the naive engine is only run on small boards by default
+            }
+            for (size_t k = 0; k < sizeof(inits) / sizeof(inits[0]); k++) {
+                for (int toroidal = 1; toroidal >= 0; toroidal--) {
+                    bool unbounded = (e == ENGINE_HASHLIFE || e == ENGINE_SPARSE);
+                    if (unbounded && !toroidal) {
+                        continue;                                   // geometry does not apply to the unbounded engines
+                    }
+                    game_state G;
+                    setup(&G, e, size, toroidal, &inits[k], threads, &rule, block);
+                    size_t step = (e == ENGINE_BITWISE) ? block : 1;   // generations per update
+                    size_t gens = cells_per_trial / ((double)size * size);
+                    if (gens < 2) gens = 2;
+                    gens = (gens + step - 1) / step * step;
+                    while (e == ENGINE_HASHLIFE && (gens & (gens - 1))) {
+                        gens &= gens - 1;                           // Hashlife memoises power-of-2 steps
+                    }
+
+                    for (size_t g = 0; g < warmup; g++) {
+                        game_update(&G);
+                    }
+                    for (size_t t = 0; t < trials; t++) {
+                        uint64_t start = clock_ns();
+                        if (e == ENGINE_HASHLIFE) {                 // macro-step: one update covers the whole trial
+                            G.gens_per_update = gens;
+                            game_update(&G);
+                        } else {
+                            for (size_t g = 0; g < gens; g += step) {
+                                game_update(&G);
+                            }
+                        }
+                        times[t] = (clock_ns() - start) * 1e-9;
+                    }
+                    qsort(times, trials, sizeof(double), compare_doubles);
+                    double median = times[trials / 2];
+                    double cells = (double)size * size * gens;
+
+                    fprintf(out, "%s,%s,%s,%s,%zu,%s,%zu,%zu,%s,%zu,%zu,%zu,%.6f,%.6f,%.4g,%.4g,%zu\n",
+                            label, engine_names[e], rule_str, kernel_names[rule.kernel], step, unbounded ? "unbounded" : (toroidal ? "toroidal" : "walled"),
+                            size, size, inits[k].name, unbounded ? 1 : threads, gens, trials,
+                            median, times[0], cells / median, median * 1e9 / cells, peak_memory_kb());
+                    fflush(out);
+                    destroy_game(&G);
+                }
+            }
+        }
+    }
+
+    free(times);
+    if (out != stdout) {
+        fclose(out);
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,297 @@
+/*
+ -------------------------------------
+ File:    checkpoint.c
+ Project: conway-game-of-life
+ Binary checkpoints: background writer and memory-mapped restore
+ -------------------------------------
+ Author:  Akshath Wikramanayake
+ Email:   akshath.wikramanayake@gmail.com
+ Version  0.0.1
+ -------------------------------------
+ */
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include <pthread.h>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+#include "life_functions.h"
+#include "checkpoint.h"
+
+
+/*
+    Mixes one word into a lane of the checksum
+*/
+static inline
+uint64_t checksum_mix(uint64_t h, uint64_t word) {
+    h = (h ^ word) * 0x9E3779B97F4A7C15ull;
+    return h ^ (h >> 29);
+}
+
+
+void checksum_start(checksum_state* S) {
+    static const uint64_t seeds[4] = { 0x243F6A8885A308D3ull, 0x13198A2E03707344ull, 0xA4093822299F31D0ull, 0x082EFA98EC4E6C89ull };
+    memcpy(S->h, seeds, sizeof(S->h));
+    S->words = 0;
+}
+
+
+void checksum_add(checksum_state* S, const uint64_t* data, size_t words) {
+    size_t k = 0;
+    for (; k < words && S->words % 4; k++) {                        // complete the group left over by the last piece
+        S->pending[S->words++ % 4] = data[k];
+        if (S->words % 4 == 0) {
+            for (int l = 0; l < 4; l++) {
+                S->h[l] = checksum_mix(S->h[l], S->pending[l]);
+            }
+        }
+    }
+    for (; k + 4 <= words; k += 4) {                                // independent lanes keep the multiplier busy
+        for (int l = 0; l < 4; l++) {
+            S->h[l] = checksum_mix(S->h[l], data[k + l]);
+        }
+        S->words += 4;
+    }
+    for (; k < words; k++) {
+        S->pending[S->words++ % 4] = data[k];
+    }
+}
+
+
+uint64_t checksum_end(const checksum_state* S) {
+    uint64_t h0 = S->h[0];
+    for (size_t k = 0; k < S->words % 4; k++) {                     // the words of the last incomplete group go to lane 0
+        h0 = checksum_mix(h0, S->pending[k]);
+    }
+    return word_hash(S->words, h0 ^ (S->h[1] * 3) ^ (S->h[2] * 5) ^ (S->h[3] * 7)) ^ S->words;
+}
+
+
+uint64_t checkpoint_checksum(const uint64_t* data, size_t words) {
+    checksum_state S;
+    checksum_start(&S);
+    checksum_add(&S, data, words);
+    return checksum_end(&S);
+}
+
+
+/*
+    Writes the snapshot to path.tmp and renames it over the checkpoint file
+    returns: true on success
+*/
+static
+bool write_checkpoint(checkpointer* C) {
+    board* B = C->snapshot;
+    size_t words = (B->n_rows + 2) * B->stride;
+    C->header.checksum = checkpoint_checksum(B->data, words);
+
+    const char* tmp = C->tmp_path;
+    bool ok = false;
+    FILE* f = fopen(tmp, "wb");
+    if (f) {
+        static const char zeros[CHECKPOINT_DATA_OFFSET];
+        ok = fwrite(&C->header, sizeof(C->header), 1, f) == 1
+          && fwrite(zeros, CHECKPOINT_DATA_OFFSET - sizeof(C->header), 1, f) == 1
+          && fwrite(B->data, sizeof(uint64_t), words, f) == words;
+        ok = (fclose(f) == 0) && ok;
+    }
+#ifdef _WIN32
+    if (ok) {
+        remove(C->path);                                            // rename does not replace files on Windows
+    }
+#endif
+    ok = ok && rename(tmp, C->path) == 0;
+    if (!ok) {
+        remove(tmp);
+    }
+    return ok;
+}
+
+
+static
+void* writer_thread(void* Cv) {
+    checkpointer* C = Cv;
+    pthread_mutex_lock(&C->mtx);
+    while (true) {
+        while (!C->pending && !C->quit) {
+            pthread_cond_wait(&C->cond, &C->mtx);
+        }
+        if (!C->pending) {
+            break;                                                  // quit once the last snapshot is written
+        }
+        pthread_mutex_unlock(&C->mtx);
+        bool ok = write_checkpoint(C);                              // the snapshot is not touched by the game while pending
+        pthread_mutex_lock(&C->mtx);
+        C->written += ok;
+        C->failed += !ok;
+        C->pending = false;
+        pthread_cond_broadcast(&C->cond);
+    }
+    pthread_mutex_unlock(&C->mtx);
+    return 0;
+}
+
+
+checkpointer* create_checkpointer(const game_state* G, const char* path, size_t interval) {
+    checkpointer* C = game_malloc(sizeof(checkpointer));
+    size_t len = strlen(path);
+    C->path = game_malloc(len + 1);
+    C->tmp_path = game_malloc(len + 5);
+    memcpy(C->path, path, len + 1);
+    memcpy(C->tmp_path, path, len);
+    memcpy(C->tmp_path + len, ".tmp", 5);
+    C->interval = interval ? interval : 1;
+    C->snapshot = create_board(G->n_rows, G->n_cols);
+    board_copy(C->snapshot, G->B);
+    C->snap_gen = G->generation;
+    C->snap_epoch = G->epoch;
+    memset(&C->header, 0, sizeof(C->header));
+    pthread_mutex_init(&C->mtx, 0);
+    pthread_cond_init(&C->cond, 0);
+    C->pending = false;
+    C->quit = false;
+    C->written = 0;
+    C->skipped = 0;
+    C->failed = 0;
+    pthread_create(&C->thread, 0, writer_thread, C);
+    return C;
+}
+
+
+void destroy_checkpointer(checkpointer* C) {
+    pthread_mutex_lock(&C->mtx);
+    C->quit = true;
+    pthread_cond_broadcast(&C->cond);
+    pthread_mutex_unlock(&C->mtx);
+    pthread_join(C->thread, 0);
+    pthread_cond_destroy(&C->cond);
+    pthread_mutex_destroy(&C->mtx);
+    destroy_board(C->snapshot);
+    free(C->path);
+    free(C->tmp_path);
+    free(C);
+}
+
+
+bool checkpoint_save(checkpointer* C, const game_state* G, bool wait) {
+    pthread_mutex_lock(&C->mtx);
+    if (C->pending && !wait) {
+        C->skipped++;
+        pthread_mutex_unlock(&C->mtx);
+        return false;
+    }
+    while (C->pending) {
+        pthread_cond_wait(&C->cond, &C->mtx);
+    }
+    pthread_mutex_unlock(&C->mtx);
+
+    board_copy_changed(C->snapshot, G, C->snap_gen, C->snap_epoch);    // the writer is idle: bring the snapshot up to date
+    C->snap_gen = G->generation;
+    C->snap_epoch = G->epoch;
+
+    checkpoint_header* h = &C->header;
+    memcpy(h->magic, CHECKPOINT_MAGIC, sizeof(h->magic));
+    h->version = CHECKPOINT_VERSION;
+    h->toroidal = G->toroidal;
+    h->n_rows = G->n_rows;
+    h->n_cols = G->n_cols;
+    h->stride = G->B->stride;
+    h->generation = G->generation;
+    h->updates = G->updates;
+    h->hash = G->hash;
+    rule_name(&G->rule, h->rule, sizeof(h->rule));
+
+    pthread_mutex_lock(&C->mtx);
+    C->pending = true;
+    pthread_cond_broadcast(&C->cond);
+    while (wait && C->pending) {
+        pthread_cond_wait(&C->cond, &C->mtx);
+    }
+    pthread_mutex_unlock(&C->mtx);
+    return true;
+}
+
+
+bool read_checkpoint_header(const char* path, checkpoint_header* h) {
+    FILE* f = fopen(path, "rb");
+    if (!f) {
+        return false;
+    }
+    bool ok = fread(h, sizeof(*h), 1, f) == 1
+           && !memcmp(h->magic, CHECKPOINT_MAGIC, sizeof(h->magic))
+           && h->version == CHECKPOINT_VERSION
+           && h->stride == (h->n_cols + 63) / 64 + 2;
+    fclose(f);
+    return ok;
+}
+
+
+board* map_checkpoint(const char* path, const checkpoint_header* h, bool verify) {
+    size_t words = (h->n_rows + 2) * h->stride;
+    size_t size = CHECKPOINT_DATA_OFFSET + words * sizeof(uint64_t);
+    void* base = NULL;
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE) {
+        return NULL;
+    }
+    LARGE_INTEGER file_size;
+    HANDLE mapping = NULL;
+    if (GetFileSizeEx(file, &file_size) && (uint64_t)file_size.QuadPart >= size) {
+        mapping = CreateFileMappingA(file, NULL, PAGE_WRITECOPY, 0, 0, NULL);
+    }
+    if (mapping) {
+        base = MapViewOfFile(mapping, FILE_MAP_COPY, 0, 0, size);
+        CloseHandle(mapping);                                       // the view keeps the mapping alive
+    }
+    CloseHandle(file);
+    if (!base) {
+        return NULL;
+    }
+#else
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return NULL;
+    }
+    struct stat st;
+    if (fstat(fd, &st) == 0 && (uint64_t)st.st_size >= size) {
+        base = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    }
+    close(fd);                                                      // the mapping stays valid after closing
+    if (!base || base == MAP_FAILED) {
+        return NULL;
+    }
+#endif
+
+    board* B = game_malloc(sizeof(board));
+    B->n_rows = h->n_rows;
+    B->n_cols = h->n_cols;
+    B->stride = h->stride;
+    B->data = (uint64_t*)((char*)base + CHECKPOINT_DATA_OFFSET);
+    B->map_base = base;
+    B->map_size = size;
+    if (verify && checkpoint_checksum(B->data, words) != h->checksum) {
+        destroy_board(B);
+        return NULL;
+    }
+    return B;
+}
+
+
+void unmap_board(board* B) {
+#ifdef _WIN32
+    UnmapViewOfFile(B->map_base);
+#else
+    munmap(B->map_base, B->map_size);
+#endif
+}
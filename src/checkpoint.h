@@ -0,0 +1,156 @@
+/*
+ -------------------------------------
+ File:    checkpoint.h
+ Project: conway-game-of-life
+ Header for binary checkpoints of the game board
+ -------------------------------------
+ Author:  Akshath Wikramanayake
+ Email:   akshath.wikramanayake@gmail.com
+ Version  0.0.1
+ -------------------------------------
+ */
+
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <pthread.h>
+
+#include "life_functions.h"
+
+#define CHECKPOINT_MAGIC "LIFECKPT"
+#define CHECKPOINT_VERSION 1
+#define CHECKPOINT_DATA_OFFSET 4096     // the board data starts on a page boundary so it can be mapped in place
+
+
+/*
+    Checkpoint file layout: this header (padded to CHECKPOINT_DATA_OFFSET bytes), then the padded board data
+    exactly as it is stored in memory ((n_rows + 2) * stride words, see board). All fields are little-endian.
+*/
+typedef struct _checkpoint_header {
+    char magic[8];              // CHECKPOINT_MAGIC
+    uint32_t version;           // CHECKPOINT_VERSION
+    uint32_t toroidal;          // board geometry: 1 toroidal, 0 walled
+    uint64_t n_rows;
+    uint64_t n_cols;
+    uint64_t stride;            // words per padded row
+    uint64_t generation;        // generation of the board
+    uint64_t updates;           // # of updates made so far (counted against maxiters)
+    uint64_t hash;              // board hash of the game (see word_hash)
+    uint64_t checksum;          // checksum of the board data (see checkpoint_checksum)
+    char rule[32];              // rulestring, e.g. "B3/S23"
+} checkpoint_header;
+
+
+/*
+    Background checkpoint writer. The game thread copies the tiles that changed since the last checkpoint
+    into the snapshot and hands it over; the writer thread computes the checksum and writes the file, so the
+    update loop never waits for the disk.
+*/
+typedef struct _checkpointer {
+    char* path;                 // checkpoint file (replaced atomically: written to tmp_path, then renamed)
+    char* tmp_path;             // path.tmp
+    size_t interval;            // # of updates between checkpoints
+    board* snapshot;            // copy of the board being written
+    size_t snap_gen;            // generation copied into the snapshot
+    size_t snap_epoch;          // G->epoch of the snapshot
+    checkpoint_header header;   // header of the snapshot
+
+    pthread_t thread;
+    pthread_mutex_t mtx;        // protects pending and quit
+    pthread_cond_t cond;        // signalled when a snapshot is handed over or written
+    bool pending;               // snapshot handed to the writer and not written yet
+    bool quit;                  // set to true to make the writer exit
+
+    size_t written;             // # of checkpoints written
+    size_t skipped;             // # of checkpoints skipped because the writer was still busy
+    size_t failed;              // # of checkpoints that could not be written
+} checkpointer;
+
+
+/*
+    Creates a checkpoint writer for the game and starts its thread. The snapshot starts as a copy of the
+    current board, so create it after the board has been set up and before the game starts.
+    path: checkpoint file
+    interval: # of updates between checkpoints
+    returns: pointer to the new writer
+*/
+checkpointer* create_checkpointer(const game_state* G, const char* path, size_t interval);
+
+
+/*
+    Waits for the last checkpoint to be written, stops the writer thread and deallocates it
+*/
+void destroy_checkpointer(checkpointer*);
+
+
+/*
+    Hands the current board to the writer
+    wait: true: wait until the writer is idle and then until the checkpoint is written |
+          false: skip the checkpoint if the writer is still busy with the previous one
+    returns: true if the checkpoint was handed over
+*/
+bool checkpoint_save(checkpointer*, const game_state* G, bool wait);
+
+
+/*
+    Running checksum of board data that arrives in pieces (see checksum_add)
+*/
+typedef struct _checksum_state {
+    uint64_t h[4];              // lanes
+    uint64_t pending[4];        // words of an incomplete group of 4
+    size_t words;               // # of words added so far
+} checksum_state;
+
+
+/*
+    Checksum of board data (4 interleaved multiply-xor lanes)
+    words: # of 64-bit words
+*/
+uint64_t checkpoint_checksum(const uint64_t* data, size_t words);
+
+
+/*
+    Starts a running checksum; adding all the data in pieces gives the same result as checkpoint_checksum
+*/
+void checksum_start(checksum_state*);
+
+
+/*
+    Adds the next words of the data to a running checksum
+*/
+void checksum_add(checksum_state*, const uint64_t* data, size_t words);
+
+
+/*
+    returns: checksum of all the words added
+*/
+uint64_t checksum_end(const checksum_state*);
+
+
+/*
+    Reads and validates the header of a checkpoint file
+    returns: true if the file is a checkpoint of a supported version
+*/
+bool read_checkpoint_header(const char* path, checkpoint_header* h);
+
+
+/*
+    Maps the board data of a checkpoint file into memory (copy-on-write: the file is never modified).
+    Pages are only read from the file when they are first accessed, so restoring is near-instant
+    even on very large boards.
+    verify: true: check the checksum (reads the whole file)
+    returns: board whose data lives in the mapping (destroy it with destroy_board) | NULL on failure
+*/
+board* map_checkpoint(const char* path, const checkpoint_header* h, bool verify);
+
+
+/*
+    Releases the file mapping that holds the data of a board created by map_checkpoint
+    (called by destroy_board)
+*/
+void unmap_board(board*);
+
+#endif
@@ -0,0 +1,101 @@
+/*
+ -------------------------------------
+ File:    cycle.c
+ Project: conway-game-of-life
+ Cycle (oscillator) detection using a history of board hashes
+ -------------------------------------
+ Author:  Akshath Wikramanayake
+ Email:   akshath.wikramanayake@gmail.com
+ Version  0.0.1
+ -------------------------------------
+ */
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "life_functions.h"
+#include "cycle.h"
+
+
+cycle_detector* create_cycle_detector(size_t rows, size_t cols, size_t capacity) {
+    cycle_detector* C = game_malloc(sizeof(cycle_detector));
+    C->capacity = capacity;
+    C->history = game_calloc(capacity, sizeof(cycle_entry));
+    size_t n_slots = 1;
+    while (n_slots < 4 * capacity) {                                // keep the index sparse so few entries are overwritten
+        n_slots *= 2;
+    }
+    C->index = game_calloc(n_slots, sizeof(size_t));
+    C->index_mask = n_slots - 1;
+    C->snapshot = create_board(rows, cols);
+    cycle_reset(C);
+    return C;
+}
+
+
+void destroy_cycle_detector(cycle_detector* C) {
+    destroy_board(C->snapshot);
+    free(C->index);
+    free(C->history);
+    free(C);
+}
+
+
+void cycle_reset(cycle_detector* C) {
+    memset(C->index, 0, (C->index_mask + 1) * sizeof(size_t));
+    C->n_recorded = 0;
+    C->snap_entry = 0;
+    C->snap_period = 0;
+    C->period = 0;
+    C->start = 0;
+    C->start_min = 0;
+}
+
+
+/*
+    true if entry n is still in the ring buffer
+*/
+static inline
+bool in_history(const cycle_detector* C, size_t n) {
+    return n < C->n_recorded && n + C->capacity >= C->n_recorded;
+}
+
+
+bool cycle_check(cycle_detector* C, const board* B, uint64_t hash, size_t generation) {
+    size_t n = C->n_recorded++;
+    C->history[n % C->capacity] = (cycle_entry){ hash, generation };
+
+    size_t* slot = &C->index[hash & C->index_mask];
+    size_t prev = *slot;                                            // entry # + 1 of the latest board with a colliding hash
+    *slot = n + 1;
+
+    if (C->snap_entry) {                                            // a candidate is being verified
+        if (n == C->snap_entry + C->snap_period) {
+            // the hash must repeat as well: with the unbounded engines B is only the window of the universe hashed
+            if (hash == C->history[C->snap_entry % C->capacity].hash && board_equal(B, C->snapshot)) {
+                size_t p = C->snap_period;
+                size_t first = C->snap_entry;                       // walk back to the first entry of the loop
+                while (first > 0 && in_history(C, first - 1)
+                    && C->history[(first - 1) % C->capacity].hash == C->history[(first - 1 + p) % C->capacity].hash) {
+                    first--;
+                }
+                C->period = generation - C->history[C->snap_entry % C->capacity].generation;
+                C->start = C->history[first % C->capacity].generation;
+                C->start_min = (first > 0 && in_history(C, first - 1))     // the board before it was not in the loop
+                             ? C->history[(first - 1) % C->capacity].generation + 1 : C->start;
+                return true;
+            }
+            C->snap_entry = 0;                                      // hash collision: keep looking
+        }
+        return false;
+    }
+
+    if (prev && in_history(C, prev - 1) && C->history[(prev - 1) % C->capacity].hash == hash) {
+        board_copy(C->snapshot, B);                                 // candidate: confirm one period from now
+        C->snap_entry = n;
+        C->snap_period = n - (prev - 1);
+    }
+    return false;
+}
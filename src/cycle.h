@@ -0,0 +1,79 @@
+/*
+ -------------------------------------
+ File:    cycle.h
+ Project: conway-game-of-life
+ Header for the cycle (oscillator) detector
+ -------------------------------------
+ Author:  Akshath Wikramanayake
+ Email:   akshath.wikramanayake@gmail.com
+ Version  0.0.1
+ -------------------------------------
+ */
+
+#ifndef CYCLE_H
+#define CYCLE_H
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "life_functions.h"
+
+#define CYCLE_HISTORY 4096              // # of recent board hashes kept (longest detectable period)
+
+
+typedef struct _cycle_entry {
+    uint64_t hash;              // board hash
+    size_t generation;          // generation the board was recorded at
+} cycle_entry;
+
+
+typedef struct _cycle_detector {
+    cycle_entry* history;       // ring buffer of the most recent boards, entry n is stored at n % capacity
+    size_t capacity;            // # of entries in the ring buffer
+    size_t n_recorded;          // # of boards recorded so far
+    size_t* index;              // direct-mapped table: hash -> (entry # + 1) of the latest board with that hash
+    size_t index_mask;          // # of index slots - 1 (power of 2)
+
+    board* snapshot;            // candidate repeated board, compared exactly once a period has elapsed
+    size_t snap_entry;          // entry # of the snapshot (0: no candidate)
+    size_t snap_period;         // candidate period (in entries)
+
+    size_t period;              // confirmed period in generations (0: no cycle found)
+    size_t start;               // first generation of the confirmed cycle
+    size_t start_min;           // earliest generation it may have begun at (< start when updates skip generations)
+} cycle_detector;
+
+
+/*
+    Allocates a cycle detector for boards of the given size
+    capacity: # of recent boards to remember
+    returns: pointer to the new detector
+*/
+cycle_detector* create_cycle_detector(size_t rows, size_t cols, size_t capacity);
+
+
+/*
+    Deallocates a cycle detector
+*/
+void destroy_cycle_detector(cycle_detector*);
+
+
+/*
+    Forgets all recorded boards
+*/
+void cycle_reset(cycle_detector*);
+
+
+/*
+    Records a board and checks whether the game has entered a loop. A hash match against a recent board
+    is only a candidate: the board is saved and compared exactly with the board one period later, whose hash
+    must match too (the hash covers the whole universe of the unbounded engines, the board only their window).
+    B: current board
+    hash: hash of the current board
+    generation: current generation
+    returns: true if a cycle has been confirmed (see period and start)
+*/
+bool cycle_check(cycle_detector*, const board* B, uint64_t hash, size_t generation);
+
+#endif
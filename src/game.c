@@ -11,21 +11,36 @@
  */
 
 #include <stdlib.h> 
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
 #include <pthread.h>
 #include <stdbool.h>
 #include <ncurses/ncurses.h>
 #include <stdatomic.h>
-#include <windows.h>
 
 #include "life_functions.h"
+#include "worker_pool.h"
+#include "hashlife.h"
+#include "cycle.h"
+#include "sparse.h"
+#include "patterns.h"
+#include "checkpoint.h"
+#include "rules.h"
+#include "soup.h"
+#include "perf.h"
+#include "gen_stats.h"
+#include "pacer.h"
+#include "stream.h"
+#include "recorder.h"
+#include "history.h"
 
 /*
     Flips alive/dead state of the selected tile
 */
 static inline
 void life_spawn(game_state* L) {
-    bool** M = L->Mv;
-    M[L->ypos][L->xpos] = !(M[L->ypos][L->xpos]);
+    set_cell(L->B, L->ypos, L->xpos, !get_cell(L->B, L->ypos, L->xpos));
 }
 
 
@@ -42,41 +57,364 @@ void move_cursor(game_state* L, signed t0, signed t1) {
   }
 }
 
+/*
+    Doubles (faster: true) or halves the # of updates computed per displayed frame. Past MAX_UPDATES_PER_FRAME
+    the game runs at full speed (0) and the display samples it at SAMPLE_RATE frames per second.
+*/
+static inline
+void fast_forward(game_state* L, bool faster) {
+    size_t k = L->updates_per_frame;
+    if (faster) {
+        L->updates_per_frame = (k == 0 || k >= MAX_UPDATES_PER_FRAME) ? 0 : k * 2;
+    } else {
+        L->updates_per_frame = (k == 0) ? MAX_UPDATES_PER_FRAME : (k > 1 ? k / 2 : 1);
+    }
+}
+
 static void* input_thread(void*);
 static void* draw_input_thread(void*);
 static void* game_update_thread(void*);
 static void* draw_game_thread(void* Lv);
+static void* game_input_thread(void*);
+static void run_headless(game_state*);
+static void run_soups(const game_state*, size_t, double, uint64_t, size_t);
+static int run_stream(const char*, size_t, size_t, bool, const char*, double, uint64_t, size_t, size_t);
+static void print_game_over(game_state*);
+static void print_history(game_state*);
+
+static void usage(const char* prog) {
+    fprintf(stderr, "usage: %s [-H] [-w] [-r density] [-s seed] [-l file] [-o row,col] [-e engine] [-g gens] [-j gens] [-m MB] [-c file] [-i updates] [-R file] [-V] [-b rule] [-S soups] [-P file] [-p ms] [-z zoom] [-L file] [-f updates] [-O file] [-E file] [-k updates] [-B] [-y MB] [rows [cols [maxiters [threads]]]]\n", prog);
+    fprintf(stderr, "  -H          headless: run at full speed without the terminal display and print a summary\n");
+    fprintf(stderr, "  -w          start with a flat/walled board instead of a toroidal one\n");
+    fprintf(stderr, "  -r density  fill the board with random tiles (probability of life per tile)\n");
+    fprintf(stderr, "  -s seed     seed for -r (default 1)\n");
+    fprintf(stderr, "  -l file     load a pattern file (RLE, Life 1.06 or plaintext .cells)\n");
+    fprintf(stderr, "  -o row,col  board cell that the top-left corner of the pattern is placed at (default 0,0)\n");
+    fprintf(stderr, "  -e engine   update algorithm: bitwise (default), naive, hashlife, sparse or lut\n");
+    fprintf(stderr, "  -g gens     generations per update for the hashlife engine (default 1, use powers of 2) and the\n");
+    fprintf(stderr, "              bitwise engine (temporal blocking, e.g. 8)\n");
+    fprintf(stderr, "  -j gens     jump: the hashlife engine starts this many generations after the board (seeks there\n");
+    fprintf(stderr, "              in a few macro-steps instead of stepping)\n");
+    fprintf(stderr, "  -m MB       memory budget of the hashlife engine and of the board window of -O (default 256)\n");
+    fprintf(stderr, "  -c file     write checkpoints of the game to file in the background (and once the game is over)\n");
+    fprintf(stderr, "  -i updates  # of updates between checkpoints (default 1000)\n");
+    fprintf(stderr, "  -R file     resume from a checkpoint (its board size, geometry and generation replace the defaults)\n");
+    fprintf(stderr, "  -V          skip the checksum check of -R (startup does not read the whole file)\n");
+    fprintf(stderr, "  -b rule     birth/survival rule, e.g. B36/S23 (default B3/S23, or the rule of the RLE pattern)\n");
+    fprintf(stderr, "  -S soups    soup search: run this many random boards (seeds from -s, density from -r, default 0.5)\n");
+    fprintf(stderr, "              to completion on `threads` workers and print one CSV line per soup\n");
+    fprintf(stderr, "  -P file     write the performance counters to file as CSV, one line per interval\n");
+    fprintf(stderr, "  -p ms       interval of -P in milliseconds (default 1000)\n");
+    fprintf(stderr, "  -z zoom     show zoom x zoom cells per character (default 1, 0: fit the board to the terminal)\n");
+    fprintf(stderr, "  -f updates  fast-forward: updates computed per displayed frame (default 1, 0: full speed)\n");
+    fprintf(stderr, "  -L file     log the statistics of every generation to file (binary if it ends in .bin, CSV otherwise)\n");
+    fprintf(stderr, "  -E file     record the game in the background: animated GIF (.gif), PNG sequence (.png) or delta stream\n");
+    fprintf(stderr, "  -k updates  # of updates between recorded frames (default 1)\n");
+    fprintf(stderr, "  -B          make the game wait for the recorder when its queue is full instead of dropping frames\n");
+    fprintf(stderr, "  -y MB       memory budget of the history kept to pause and rewind the game (default %d, 0: none);\n", HISTORY_DEFAULT_MB);
+    fprintf(stderr, "              headless runs only keep one when it is given and report its cost (not\n");
+    fprintf(stderr, "              with the hashlife and sparse engines)\n");
+    fprintf(stderr, "  -O file     out-of-core: run the board stored in checkpoint file (created from -r, rows and cols if\n");
+    fprintf(stderr, "              -r is given) until it stops, streaming it through the -m window, and print a summary\n");
+}
 
 int main (int argc, char* argv[argc+1]) {
     size_t rows = 15;
     size_t cols = 50;
     size_t maxiters = 250;
+    size_t engine = ENGINE_BITWISE;
+    size_t threads = 1;
+    size_t gens = 1;
+    size_t jump = 0;
+    size_t budget_mb = 256;
+    bool headless = false;
+    bool toroidal = true;
+    double density = 0;
+    uint64_t seed = 1;
+    const char* pattern = NULL;
+    long long pattern_y = 0;
+    long long pattern_x = 0;
+    const char* ckpt_path = NULL;
+    size_t ckpt_interval = 1000;
+    const char* restore = NULL;
+    bool verify = true;
+    const char* rulestring = NULL;
+    size_t soups = 0;
+    const char* perf_path = NULL;
+    size_t perf_interval = 1000;
+    size_t zoom = 1;
+    const char* stats_path = NULL;
+    size_t ffwd = 1;
+    const char* stream_path = NULL;
+    const char* rec_path = NULL;
+    size_t rec_every = 1;
+    bool rec_block = false;
+    long hist_mb = -1;                                          // -1: the default of the mode
 
-    if (argc > 1) rows = strtoull(argv[1], 0, 0);
-    if (argc > 2) cols = strtoull(argv[2], 0, 0);
-    if (argc > 3) maxiters = strtoull(argv[3], 0, 0);
+    int opt;
+    while ((opt = getopt(argc, argv, "Hwr:s:l:o:e:g:j:m:c:i:R:Vb:S:P:p:z:L:f:O:E:k:By:")) != -1) {
+        switch (opt) {
+        case 'H' : headless = true; break;
+        case 'w' : toroidal = false; break;
+        case 'r' : density = strtod(optarg, 0); break;
+        case 's' : seed = strtoull(optarg, 0, 0); break;
+        case 'l' : pattern = optarg; break;
+        case 'o' :
+            if (sscanf(optarg, "%lld,%lld", &pattern_y, &pattern_x) != 2) { usage(argv[0]); return EXIT_FAILURE; }
+            break;
+        case 'e' :
+            if (!strcmp(optarg, "bitwise")) engine = ENGINE_BITWISE;
+            else if (!strcmp(optarg, "naive")) engine = ENGINE_NAIVE;
+            else if (!strcmp(optarg, "hashlife")) engine = ENGINE_HASHLIFE;
+            else if (!strcmp(optarg, "sparse")) engine = ENGINE_SPARSE;
+            else if (!strcmp(optarg, "lut")) engine = ENGINE_LUT;
+            else { usage(argv[0]); return EXIT_FAILURE; }
+            break;
+        case 'g' : gens = strtoull(optarg, 0, 0); break;
+        case 'j' : jump = strtoull(optarg, 0, 0); break;
+        case 'm' : budget_mb = strtoull(optarg, 0, 0); break;
+        case 'c' : ckpt_path = optarg; break;
+        case 'i' : ckpt_interval = strtoull(optarg, 0, 0); break;
+        case 'R' : restore = optarg; break;
+        case 'V' : verify = false; break;
+        case 'b' : rulestring = optarg; break;
+        case 'S' : soups = strtoull(optarg, 0, 0); break;
+        case 'P' : perf_path = optarg; break;
+        case 'p' : perf_interval = strtoull(optarg, 0, 0); break;
+        case 'z' : zoom = strtoull(optarg, 0, 0); break;
+        case 'L' : stats_path = optarg; break;
+        case 'f' : ffwd = strtoull(optarg, 0, 0); break;
+        case 'O' : stream_path = optarg; break;
+        case 'E' : rec_path = optarg; break;
+        case 'k' : rec_every = strtoull(optarg, 0, 0); break;
+        case 'B' : rec_block = true; break;
+        case 'y' : hist_mb = strtol(optarg, 0, 0); break;
+        default : usage(argv[0]); return EXIT_FAILURE;
+        }
+    }
+
+    if (argc > optind) rows = strtoull(argv[optind], 0, 0);
+    if (argc > optind + 1) cols = strtoull(argv[optind + 1], 0, 0);
+    if (argc > optind + 2) maxiters = strtoull(argv[optind + 2], 0, 0);
+    if (argc > optind + 3) threads = strtoull(argv[optind + 3], 0, 0);
+
+    if (stream_path) {                                          // the board never lives in memory
+        return run_stream(stream_path, rows, cols, toroidal, rulestring, density, seed, maxiters, budget_mb);
+    }
+
+    checkpoint_header ck;
+    if (restore) {
+        if (!read_checkpoint_header(restore, &ck)) {
+            fprintf(stderr, "%s: not a checkpoint file\n", restore);
+            return EXIT_FAILURE;
+        }
+        rows = ck.n_rows;
+        cols = ck.n_cols;
+        toroidal = ck.toroidal;
+        if (!rulestring) {                                      // -b overrides the rule of the checkpoint, as with -O
+            rulestring = ck.rule;
+        }
+    }
 
     game_state G;
-    init_game(&G, rows, cols, maxiters, true);
+    init_game(&G, rows, cols, maxiters, toroidal);
+    if (restore) {                                              // the board data stays in the file until it is touched
+        board* B = map_checkpoint(restore, &ck, verify);
+        if (!B) {
+            fprintf(stderr, "%s: could not map the checkpoint%s\n", restore, verify ? " (or its checksum does not match)" : "");
+            destroy_game(&G);
+            return EXIT_FAILURE;
+        }
+        destroy_board(G.B);
+        G.B = B;
+        G.generation = ck.generation;
+        G.updates = ck.updates;
+    }
+    G.engine = engine;
+    G.gens_per_update = gens ? gens : 1;
+    if (jump && engine != ENGINE_HASHLIFE) {
+        fprintf(stderr, "-j needs the hashlife engine\n");
+        destroy_game(&G);
+        return EXIT_FAILURE;
+    }
+    G.jump = jump;
+    G.updates_per_frame = (ffwd <= MAX_UPDATES_PER_FRAME) ? ffwd : 0;
+    if (density > 0) {
+        board_randomise(G.B, density, seed);
+    }
+    pattern_info info;
+    if (pattern) {                                              // the pattern is drawn on top of the random tiles
+        if (!load_pattern(G.B, pattern, pattern_y, pattern_x, &info)) {
+            fprintf(stderr, "%s: could not load %s pattern (line %zu)\n", pattern, pattern_format_name(info.format), info.line);
+            destroy_game(&G);
+            return EXIT_FAILURE;
+        }
+        if (headless) {
+            printf("pattern: %s, %zu cells (%zu outside the board)\n", pattern_format_name(info.format), info.cells, info.clipped);
+        }
+        if (!rulestring && info.rule[0]) {                      // the pattern was made for this rule
+            rulestring = info.rule;
+        }
+    }
+    if (rulestring && !parse_rule(rulestring, &G.rule)) {
+        fprintf(stderr, "%s: unsupported rule (expected e.g. B36/S23, B0 rules are not supported)\n", rulestring);
+        destroy_game(&G);
+        return EXIT_FAILURE;
+    }
+    if (soups) {                                                // many small boards instead of one game
+        bool ok = (engine == ENGINE_BITWISE || engine == ENGINE_NAIVE || engine == ENGINE_LUT);
+        if (ok) {
+            run_soups(&G, soups, density > 0 ? density : 0.5, seed, threads);
+        } else {
+            fprintf(stderr, "soup search needs a bounded engine (bitwise, naive or lut)\n");
+        }
+        destroy_game(&G);
+        return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+    if (engine == ENGINE_HASHLIFE) {                            // the engines are compiled for the rule
+        G.hl = create_hashlife(budget_mb << 20, &G.rule);
+    } else if (engine == ENGINE_SPARSE) {
+        G.sparse = create_sparse_grid(&G.rule);
+    } else if (threads > 1) {
+        size_t bands = rows / TILE_ROWS ? rows / TILE_ROWS : 1;     // bands are rounded to whole tile rows
+        G.pool = create_pool(threads < bands ? threads : bands);    // at least 1 tile row per band
+    }
+
+    perf_logger* perf_log = NULL;
+    if (!headless || perf_path) {                               // headless runs are only timed when the counters are dumped
+        G.perf = create_perf(rows * cols);
+    }
+    if (perf_path && !(perf_log = create_perf_logger(G.perf, perf_path, perf_interval))) {
+        fprintf(stderr, "%s: could not open the stats file\n", perf_path);
+        destroy_game(&G);
+        return EXIT_FAILURE;
+    }
+    if (stats_path && !(G.stats = create_stats_writer(stats_path))) {
+        fprintf(stderr, "%s: could not open the statistics log\n", stats_path);
+        if (perf_log) {
+            destroy_perf_logger(perf_log);
+        }
+        destroy_game(&G);
+        return EXIT_FAILURE;
+    }
+    size_t hist_budget = (hist_mb >= 0) ? (size_t)hist_mb << 20 : (headless ? 0 : (size_t)HISTORY_DEFAULT_MB << 20);
+    if (hist_budget && (engine == ENGINE_HASHLIFE || engine == ENGINE_SPARSE)) {
+        if (hist_mb > 0) {                                          // the history only holds the window, not the universe
+            fprintf(stderr, "no history with the %s engine: it cannot rebuild the universe outside the board\n",
+                    engine == ENGINE_HASHLIFE ? "hashlife" : "sparse");
+        }
+        hist_budget = 0;
+    }
+    if (hist_budget && !(G.hist = create_history(&G, hist_budget)) && hist_mb >= 0) {    // the default is dropped quietly
+        fprintf(stderr, "history budget of %ld MB is too small for a keyframe of this board\n", hist_mb);
+        if (perf_log) {
+            destroy_perf_logger(perf_log);
+        }
+        destroy_game(&G);
+        return EXIT_FAILURE;
+    }
+
+    if (headless) {
+        if (ckpt_path) {
+            G.ckpt = create_checkpointer(&G, ckpt_path, ckpt_interval);
+        }
+        if (rec_path && !(G.rec = create_recorder(&G, rec_path, rec_every, rec_block))) {
+            fprintf(stderr, "%s: could not open the recording (GIFs are limited to 65535 x 65535 cells)\n", rec_path);
+            if (perf_log) {
+                destroy_perf_logger(perf_log);
+            }
+            destroy_game(&G);
+            return EXIT_FAILURE;
+        }
+        run_headless(&G);
+        if (perf_log) {
+            destroy_perf_logger(perf_log);
+        }
+        if (G.ckpt) {
+            checkpoint_save(G.ckpt, &G, true);                  // final state, so the run can be resumed
+            printf("checkpoints: %zu written, %zu skipped (writer busy), %zu failed\n",
+                   G.ckpt->written, G.ckpt->skipped, G.ckpt->failed);
+        }
+        if (G.stats) {
+            printf("statistics log: %zu generations logged, %zu dropped (writer busy)\n", G.stats->logged, G.stats->dropped);
+        }
+        if (G.rec) {
+            recorder* R = G.rec;
+            record_frame(R, &G, true);                          // final board
+            record_flush(R);
+            printf("recording: %zu frames, %zu dropped (encoder busy), %zu failed, %.1f KiB, %.3f ms encoding per frame\n",
+                   R->produced, R->dropped, R->failed, R->bytes / 1024.0, R->produced ? R->encode_ns * 1e-6 / R->produced : 0.0);
+        }
+        if (G.hist) {
+            print_history(&G);
+        }
+        destroy_game(&G);
+        return EXIT_SUCCESS;
+    }
 
     initscr();
     cbreak();
     noecho();
+    view_init(&G.view, rows, cols, zoom, LINES, COLS);          // boards larger than the terminal are scrolled or zoomed out
 
-    pthread_t in_thrd[2];                                       // Threads for the input/setup portion of the game
-    pthread_create(&in_thrd[0], 0, input_thread, &G);
-    pthread_create(&in_thrd[1], 0, draw_input_thread, &G);
+    pacer update_pace;
+    G.pacer = &update_pace;
+    while (true) {                                              // a paused game can go back to the input phase
+        pthread_t in_thrd[2];                                   // Threads for the input/setup portion of the game
+        pthread_create(&in_thrd[0], 0, input_thread, &G);
+        pthread_create(&in_thrd[1], 0, draw_input_thread, &G);
 
-    pthread_join(in_thrd[0], 0);
-    pthread_join(in_thrd[1], 0);
+        pthread_join(in_thrd[0], 0);
+        pthread_join(in_thrd[1], 0);
 
 
-    pthread_t game_thrd[2];                                     // Threads for the actual game
-    pthread_create(&game_thrd[0], 0, game_update_thread, &G);
-    pthread_create(&game_thrd[1], 0, draw_game_thread, &G);
+        G.renderer = create_renderer(&G, G.starty);             // the input phase left the board on screen
+        pacer_start(&update_pace, G.update_rate);               // restarted by the update thread, read by the display
+        if (ckpt_path && !G.ckpt) {
+            G.ckpt = create_checkpointer(&G, ckpt_path, ckpt_interval);
+        }
+        if (rec_path && !G.rec && !(G.rec = create_recorder(&G, rec_path, rec_every, rec_block))) {    // records the board left by the input phase
+            endwin();
+            fprintf(stderr, "%s: could not open the recording (GIFs are limited to 65535 x 65535 cells)\n", rec_path);
+            if (perf_log) {
+                destroy_perf_logger(perf_log);
+            }
+            destroy_game(&G);
+            return EXIT_FAILURE;
+        }
+        pthread_t game_thrd[3];                                 // Threads for the actual game
+        pthread_create(&game_thrd[0], 0, game_update_thread, &G);
+        pthread_create(&game_thrd[1], 0, draw_game_thread, &G);
+        timeout(100);                                           // getch gives up regularly so the game input thread sees the end
+        pthread_create(&game_thrd[2], 0, game_input_thread, &G);
 
-    pthread_join(game_thrd[0], 0);
-    pthread_join(game_thrd[1], 0);
+        pthread_join(game_thrd[0], 0);
+        pthread_join(game_thrd[1], 0);
+        pthread_join(game_thrd[2], 0);
+        timeout(-1);
+        if (!G.edit) {
+            break;
+        }
+        destroy_renderer(G.renderer);                           // the input phase redraws the board it edits
+        G.renderer = NULL;
+        G.epoch++;                                              // edited: the copies kept with tile_gen are refreshed in full
+        G.inp_over = false;
+        G.finished = false;
+        G.paused = false;
+        G.edit = false;
+        G.seek = 0;
+        clear();
+    }
+    if (G.ckpt) {
+        checkpoint_save(G.ckpt, &G, true);
+    }
+    if (G.rec) {
+        record_frame(G.rec, &G, true);
+    }
+    if (perf_log) {
+        destroy_perf_logger(perf_log);                          // last line: the final counters
+    }
+    print_game_over(&G);
 
     getch();                                                    // Wait for user input to end
     endwin();
@@ -91,57 +429,63 @@ void* draw_input_thread(void* Gv) {
     size_t ypos = 0;
     size_t spawns = 0;
     size_t update_rate = 0;
+    size_t ffwd = G->updates_per_frame;
     bool toroidal = G->toroidal;
 
     xpos = G->xpos;
     ypos = G->ypos;
 
     WIN win;
-    init_win_params(&win, G->n_rows, G->n_cols, 2, 0);
+    init_win_params(&win, G->view.rows, G->view.cols, 2, 0);
+    pacer display;
+    pacer_start(&display, DISPLAY_RATE);
 
-    mvprintw(0, 0, "Move: WASD | adjust update rate: q/e or +/- | spawn: f or SPACE\n");
+    mvprintw(0, 0, "Move: WASD | adjust update rate: q/e or +/- | fast-forward: < / > | spawn: f or SPACE\n");
     mvprintw(1,0, "Change Geometry: T | Start game: ENTER or ESCAPE");
     G->starty = 3;
     create_box(&win, TRUE);
     refresh();
     draw_board(G);
-    draw_cursor(ypos, xpos, 3, false);
-    print_gameParams(G->toroidal, G->update_rate, G->maxiters, G->n_rows);
-    print_lastcom(G->last_command, G->n_rows);
+    draw_cursor(&G->view, ypos, xpos, 3, false);
+    print_gameParams(G->toroidal, G->update_rate, G->updates_per_frame, NULL, G->maxiters, G->view.rows);
+    print_lastcom(G->last_command, G->view.rows);
     refresh();
    
     while (!G->inp_over) {
-        pthread_mutex_lock(&G->mtx);                            // WAIT IF:
+        perf_lock(G->perf, &G->mtx);                            // WAIT IF:
         while (!G->inp_over                                     // - input phase not over
             && (xpos == G->xpos)                                // - current displayed cursor position not outdated
             && (ypos == G->ypos)
+            && (ffwd == G->updates_per_frame)                   // - correct fast-forward is displayed
             && (update_rate = G->update_rate)                   // - correct update rate is displayed
             && (spawns = G->spawns)) { // "... y ...."          // - all user-added spawns/kills drawn
-            timed_cond_wait(&G->draw_inp, &G->mtx);
+            perf_cond_wait(G->perf, &G->draw_inp, &G->mtx);
         }
 
         // VVVVVVVVVVVVVVVVVVVVVVVVVVVVVVVVVVVVVVVVVVVVVVVVV    // code inside these cages is executed holding the mutex
+        draw_cursor(&G->view, ypos, xpos, 3, true);            // erased before the view scrolls away from it
+        xpos = G->xpos;
+        ypos = G->ypos;
+        view_follow(&G->view, ypos, xpos);                      // keep the cursor in view
         draw_board(G);
         spawns = G->spawns;                                     // ensure thread knows if displayed spawns/kills are up to date
         // ^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^
         pthread_mutex_unlock(&G->mtx);
 
-        mvprintw(G->n_rows + 5, 13, "%3d", G->update_rate);
-        draw_cursor(ypos, xpos, 3, true);
-        xpos = G->xpos;
-        ypos = G->ypos;
+        mvprintw(G->view.rows + 5, 13, "%3zu", G->update_rate);
         update_rate = G->update_rate;
-        draw_cursor(ypos, xpos, 3, false);
-        if (toroidal != G->toroidal) {
-            print_gameParams(G->toroidal, G->update_rate, G->maxiters, G->n_rows);
+        draw_cursor(&G->view, ypos, xpos, 3, false);
+        if (toroidal != G->toroidal || ffwd != G->updates_per_frame) {
+            ffwd = G->updates_per_frame;
+            print_gameParams(G->toroidal, G->update_rate, ffwd, NULL, G->maxiters, G->view.rows);
             toroidal = G->toroidal;
         }
-        print_lastcom(G->last_command, G->n_rows);
+        print_lastcom(G->last_command, G->view.rows);
         refresh();
 
-        Sleep(1000 / 120);                                      // cap refresh rate to prevent unnecessary draw calls (eg: if a move key is held down)
+        perf_add(&G->perf->sleep_ns, pacer_wait(&display));     // cap refresh rate to prevent unnecessary draw calls (eg: if a move key is held down)
     }
-    draw_cursor(ypos, xpos, 3, true);                           // erase cursor from final position before moving on
+    draw_cursor(&G->view, ypos, xpos, 3, true);                // erase cursor from final position before moving on
     return 0;
 }
 
@@ -164,7 +508,7 @@ void* input_thread(void* Gv) {
         //case 'R' : G->last_command = RESET_POS; break;
         case 't' : 
         case 'T' :
-                pthread_mutex_lock(&G->mtx);
+                perf_lock(G->perf, &G->mtx);
                 // VVVVVVVVVVVVVVVVVVVVVVVVVVVVVVVVVVVVVVVVVVVVVVVVV        // code inside these cages is executed holding the mutex
                 draw_board(G);           
                 G->last_command = TOGGLE_TOROIDAL; 
@@ -179,10 +523,14 @@ void* input_thread(void* Gv) {
         case 'q' :
         case 'Q' :        
         case '-' : G->last_command = DEC_FRAMES; if (G->update_rate > 1)   G->update_rate--; break;
+        case '.' :
+        case '>' : G->last_command = INC_FFWD; fast_forward(G, true); break;
+        case ',' :
+        case '<' : G->last_command = DEC_FFWD; fast_forward(G, false); break;
         case ' ' :
         case 'f' :
         case 'F' :
-                pthread_mutex_lock(&G->mtx);
+                perf_lock(G->perf, &G->mtx);
                 // VVVVVVVVVVVVVVVVVVVVVVVVVVVVVVVVVVVVVVVVVVVVVVVVV
                 G->last_command = SPAWN_LIFE; 
                 life_spawn(G);
@@ -205,57 +553,405 @@ FINISH:
 static 
 void* draw_game_thread(void* Gv) {
     game_state*restrict G = Gv;
-    print_lastcom(G->last_command, G->n_rows);
-    mvprintw(0, 0, "ITERATION: %d", G->drawn);
+    renderer* R = G->renderer;
+    print_lastcom(G->last_command, R->view.rows);
+    mvprintw(0, 0, "ITERATION: %zu", G->updates);
     clrtoeol();
     refresh();
-    while (!G->finished) {
-        pthread_mutex_lock(&G->mtx);
-        while (!G->finished && (G->drawn >= G->updates)) {
-            pthread_cond_signal(&G->upd);
-            timed_cond_wait(&G->draw_upd, &G->mtx);
+    bool over = false;
+    bool paused = !G->paused;                                   // the help line is printed on the first pass
+    size_t ffwd = G->updates_per_frame;
+    pacer display;
+    pacer_start(&display, DISPLAY_RATE);
+    uint64_t stats_due = 0;                                     // next time the performance counters are printed
+    while (!over) {
+        over = G->finished;                                     // read before taking the frame so the last one is drawn
+        uint64_t t0 = clock_ns();
+        bool redrawn = render_view(R, G);                       // scrolled or zoomed: the whole view was redrawn
+        if (paused != G->paused) {
+            paused = G->paused;
+            if (paused) {
+                mvprintw(1, 0, "PAUSED: step back/forward: [ / ] (100 updates: { / }) | resume: p | edit the board: i");
+            } else {
+                mvprintw(1, 0, "Scroll: WASD | zoom in/out: z/x | fast-forward: < / > | pause: p | step back: [");
+            }
+            clrtoeol();
+            redrawn = true;
+        }
+        if (redrawn || ffwd != G->updates_per_frame) {
+            ffwd = G->updates_per_frame;
+            print_lastcom(G->last_command, R->view.rows);
+            print_gameParams(G->toroidal, G->update_rate, ffwd, G->pacer, G->maxiters, R->view.rows);
+            print_perfStats(G->perf, R->view.rows);
+            redrawn = true;
         }
+        if (render_consume(R)) {                                // latest published generation, older ones are skipped
+            const frame* f = render_draw(R);                    // only the cells that flipped since the last frame
+            mvprintw(0, 0, "ITERATION: %zu", f->updates);
+            if (G->gens_per_update > 1) {
+                printw(" | GENERATION: %zu", f->generation);
+            }
+            if (paused && G->hist) {                            // what rewinding costs
+                size_t first = atomic_load_explicit(&G->perf->history_first, memory_order_relaxed);
+                size_t last = atomic_load_explicit(&G->perf->history_last, memory_order_relaxed);
+                size_t seeks = atomic_load_explicit(&G->perf->seeks, memory_order_relaxed);
+                printw(" | kept: generations %zu-%zu, %.1f bytes/gen | seek: %.3f ms", first, last,
+                       atomic_load_explicit(&G->perf->history_bytes, memory_order_relaxed) / (double)(last - first + 1),
+                       seeks ? atomic_load_explicit(&G->perf->seek_ns, memory_order_relaxed) * 1e-6 / seeks : 0.0);
+            }
+            clrtoeol();
+            if (t0 >= stats_due) {
+                print_gameParams(G->toroidal, G->update_rate, ffwd, G->pacer, G->maxiters, R->view.rows);   // achieved rate
+                print_perfStats(G->perf, R->view.rows);
+                stats_due = t0 + 250000000;                     // 4 times per second is enough to read
+            }
+            refresh();
+            perf_add(&G->perf->draw_ns, clock_ns() - t0);
+            perf_count(&G->perf->frames, 1);
+        } else if (redrawn) {
+            refresh();                                          // a view change with no new frame
+        } else if (!over) {
+            perf_add(&G->perf->sleep_ns, pacer_wait(&display)); // nothing new: check again at the display refresh rate
+        }
+    }
+    return 0;
+}
 
-        // VVVVVVVVVVVVVVVVVVVVVVVVVVVVVVVVVVVVVVVVVVVVVVVVV
-        draw_board(G);
-        mvprintw(0, 0, "ITERATION: %d", G->drawn);
-        G->drawn++;
-        refresh();
-        // ^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^
-        pthread_cond_signal(&G->upd);
+/*
+    Reads the keys of the game phase: WASD scroll the view by a quarter of its size, z/x zoom in/out by 2x,
+    </> halve/double the updates per frame. The new view is handed to the display through G->view (under G->mtx)
+    and drawn by render_view. p pauses/resumes the game, [/] (or {/} for 100 updates) pause it and step through
+    the history (see game_update_thread), i leaves a paused game for the input phase.
+*/
+static
+void* game_input_thread(void* Gv) {
+    game_state* G = Gv;
+    while (!G->finished) {
+        int c = getch();                                        // ERR after the timeout: check whether the game is over
+        size_t zoom = G->view.zoom;                             // G->view is only written by this thread in the game phase
+        long dy = 0;
+        long dx = 0;
+        long step_y = G->view.rows > 4 ? G->view.rows / 4 : 1;
+        long step_x = G->view.cols > 4 ? G->view.cols / 4 : 1;
+        switch (c) {
+        case 'a' :
+        case 'A' : dx = -step_x; break;
+        case 'd' :
+        case 'D' : dx = step_x; break;
+        case 'w' :
+        case 'W' : dy = -step_y; break;
+        case 's' :
+        case 'S' : dy = step_y; break;
+        case 'z' :
+        case 'Z' : zoom = zoom > 1 ? zoom / 2 : 1; break;
+        case 'x' :
+        case 'X' : zoom *= 2; break;
+        case '.' :
+        case '>' : G->last_command = INC_FFWD; fast_forward(G, true); continue;
+        case ',' :
+        case '<' : G->last_command = DEC_FFWD; fast_forward(G, false); continue;
+        case 'p' :
+        case 'P' : G->paused = !G->paused; G->last_command = G->paused ? PAUSE_GAME : RESUME_GAME; continue;
+        case '[' : G->paused = true; G->last_command = STEP_HISTORY; atomic_fetch_sub(&G->seek, 1); continue;
+        case ']' : G->paused = true; G->last_command = STEP_HISTORY; atomic_fetch_add(&G->seek, 1); continue;
+        case '{' : G->paused = true; G->last_command = STEP_HISTORY; atomic_fetch_sub(&G->seek, 100); continue;
+        case '}' : G->paused = true; G->last_command = STEP_HISTORY; atomic_fetch_add(&G->seek, 100); continue;
+        case 'i' :
+        case 'I' :
+            if (G->paused) {                                    // the update thread is idle: the game phase can end
+                G->last_command = EDIT_BOARD;
+                G->edit = true;
+                G->finished = true;
+            }
+            continue;
+        default : continue;
+        }
+        perf_lock(G->perf, &G->mtx);
+        view_move(&G->view, zoom, dy, dx);
         pthread_mutex_unlock(&G->mtx);
+        G->renderer->view_pending = true;
     }
     return 0;
 }
 
+/*
+    Hands the size of the history and the generations it spans to the display (see draw_game_thread)
+*/
+static inline
+void report_history(game_state* G) {
+    if (G->hist) {
+        atomic_store_explicit(&G->perf->history_bytes, G->hist->used, memory_order_relaxed);
+        atomic_store_explicit(&G->perf->history_first, G->hist->first_gen, memory_order_relaxed);
+        atomic_store_explicit(&G->perf->history_last, G->hist->last_gen, memory_order_relaxed);
+    }
+}
+
+
+/*
+    Runs the game phase. While the game is paused the board only moves when the user steps: back, or forward
+    through the generations kept, it is rebuilt from G->hist; forward past the newest one the game is stepped.
+    Once a rewound board is stepped or resumed, game_start is called again and the game goes on from it.
+*/
 static void* game_update_thread(void* Gv) {
     game_state*restrict G = Gv;
-    size_t changed = 1;
-    while (!G->finished && changed) {
-        pthread_mutex_lock(&G->mtx);
-        while (!G->finished && (G->updates != G->drawn)) {
-           timed_cond_wait(&G->upd, &G->mtx);
+    if (!game_start(G)) {                                       // e.g. the board does not fit in the Hashlife memory budget
+        G->stop_reason = STOP_FAILED;
+    }
+    if (G->stop_reason != STOP_NONE) {                          // or a resumed game already reached maxiters
+        G->finished = true;
+    }
+    perf_start(G->perf);                                        // stepping should not allocate: counted from here on
+    bool paced = false;                                         // G->pacer runs at G->update_rate
+    bool paused = false;
+    bool rewound = false;                                       // the board was rebuilt from the history while paused
+    pacer idle;                                                 // looks for steps while paused
+    pacer_start(&idle, DISPLAY_RATE);
+    while (!G->finished) {
+        if (G->paused) {
+            long steps = atomic_exchange(&G->seek, 0);
+            bool moved = !paused;                               // the status line shows the history once paused
+            paused = true;
+            paced = false;                                      // deadlines start over when the game is resumed
+            if (steps && G->hist) {
+                uint64_t t0 = clock_ns();
+                if (history_rewind(G->hist, G, steps)) {        // replayed from the keyframe before the generation
+                    perf_add(&G->perf->seek_ns, clock_ns() - t0);
+                    perf_count(&G->perf->seeks, 1);
+                    rewound = moved = true;
+                    steps = 0;
+                }
+            }
+            if (steps > 0) {                                    // past the newest board kept: the game is stepped
+                if (rewound && !game_start(G)) {
+                    G->stop_reason = STOP_FAILED;
+                    steps = 0;
+                }
+                rewound = false;
+                for (long u = 0; u < steps && G->stop_reason == STOP_NONE && game_advance(G); u++) {
+                }
+                moved = true;
+            }
+            if (moved) {
+                report_history(G);
+                render_publish(G->renderer, G);
+                perf_count(&G->perf->published, 1);
+            } else {
+                perf_add(&G->perf->sleep_ns, pacer_wait(&idle));
+            }
+            if (G->stop_reason != STOP_NONE) {
+                G->finished = true;
+            }
+            continue;
         }
-
-        // VVVVVVVVVVVVVVVVVVVVVVVVVVVVVVVVVVVVVVVVVVVVVVVVV
-        changed = game_update(G);
-        G->updates++;
-        if ((G->updates >= G->maxiters) || (changed == 0)) {
+        paused = false;
+        if (rewound) {                                          // resumed from a rewound board: its old future is dropped
+            rewound = false;
+            if (!game_start(G)) {
+                G->stop_reason = STOP_FAILED;
+            }
+            if (G->stop_reason != STOP_NONE) {
+                G->finished = true;
+                break;
+            }
+        }
+        size_t k = G->updates_per_frame;                        // the board belongs to this thread: the display only sees frames
+        bool go_on = true;
+        if (k && (!paced || G->pacer->rate != G->update_rate)) {
+            pacer_start(G->pacer, G->update_rate);              // deadlines from now on (e.g. back from full speed)
+        }
+        paced = (k != 0);
+        if (k) {                                                // fast-forward: k updates per frame, then the usual pause
+            for (size_t u = 0; u < k && go_on; u++) {
+                go_on = game_advance(G);                        // every update is checked for maxiters, steady states and cycles
+            }
+        } else {                                                // full speed: publish a sample of the game SAMPLE_RATE times per second
+            uint64_t due = clock_ns() + 1000000000 / SAMPLE_RATE;
+            do {
+                go_on = game_advance(G);
+            } while (go_on && G->updates_per_frame == 0 && clock_ns() < due);
+        }
+        report_history(G);
+        render_publish(G->renderer, G);
+        perf_count(&G->perf->published, 1);
+        if (!go_on) {
             G->finished = true;
         }
-        // ^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^
-        pthread_cond_signal(&G->draw_upd);
-        pthread_mutex_unlock(&G->mtx);
-        Sleep((1.0 / G->update_rate) * 1000);
+        if (k) {
+            perf_add(&G->perf->sleep_ns, pacer_wait(G->pacer)); // until the next deadline, whatever the update and publish took
+        }
     }
+    return 0;
+}
+
 
-    if (changed == 0) {
-        mvprintw(1, 0, "GAME OVER: steady state detected. Press any key to exit.");
-        clrtoeol();
+/*
+    Prints the reason the game ended and the final performance counters once both game threads are done
+*/
+static
+void print_game_over(game_state* G) {
+    switch (G->stop_reason) {
+        case STOP_FAILED: mvprintw(1, 0, "GAME OVER: Hashlife memory budget exceeded. Press any key to exit."); break;
+        case STOP_STEADY: mvprintw(1, 0, "GAME OVER: steady state detected. Press any key to exit."); break;
+        case STOP_CYCLE: mvprintw(1, 0, "GAME OVER: cycle of period %zu detected (began at generation %zu%s). Press any key to exit.",
+                                  G->cycle->period, G->cycle->start, G->cycle->start_min < G->cycle->start ? " or earlier" : ""); break;
+        default: mvprintw(1, 0, "GAME OVER: Max iterations reached. Press any key to exit."); break;
+    }
+    clrtoeol();
+    print_perfStats(G->perf, G->renderer->view.rows);           // heap allocations during the game, frames drawn vs published
+    refresh();
+}
+
+
+/*
+    Prints what the history of a headless run kept and what it cost: bytes per generation and the latency of
+    rebuilding boards spread over the generations kept
+*/
+static
+void print_history(game_state* G) {
+    history* H = G->hist;
+    board* B = create_board(G->n_rows, G->n_cols);
+    size_t span = H->last_gen - H->first_gen + 1;
+    size_t n = span < HISTORY_SEEKS ? span : HISTORY_SEEKS;
+    size_t gen, updates;
+    for (size_t k = 0; k < n; k++) {
+        history_seek(H, H->first_gen + k * (span - 1) / (n > 1 ? n - 1 : 1), B, &gen, &updates);
+    }
+    destroy_board(B);
+    printf("history: generations %zu-%zu kept in %.1f KiB (%zu records, %zu evicted)\n",
+           H->first_gen, H->last_gen, H->used / 1024.0, H->n_records, H->evicted);
+    printf("history cost: %.1f bytes/generation kept, %.1f bytes/delta (%zu), %.1f bytes/keyframe (%zu)\n",
+           (double)H->used / span, H->deltas ? (double)H->delta_total / H->deltas : 0.0, H->deltas,
+           H->keys ? (double)H->key_total / H->keys : 0.0, H->keys);
+    printf("seek: %.3f ms average, %.3f ms worst over %zu seeks\n",
+           H->seeks ? H->seek_ns * 1e-6 / H->seeks : 0.0, H->seek_max_ns * 1e-6, H->seeks);
+}
+
+
+/*
+    Runs the game at full speed without ncurses, pacing or waiting for the display, then prints a summary
+*/
+static
+void run_headless(game_state* G) {
+    uint64_t start = clock_ns();
+    if (!game_start(G)) {
+        G->stop_reason = STOP_FAILED;
+    }
+    size_t allocs = game_alloc_count();
+    if (G->perf) {
+        perf_start(G->perf);
+    }
+    while (G->stop_reason == STOP_NONE && game_advance(G)) {
+    }
+    double secs = (clock_ns() - start) * 1e-9;
+
+    char rule[32];
+    rule_name(&G->rule, rule, sizeof(rule));
+    printf("rule: %s\n", rule);
+    printf("generations: %zu\n", G->generation);
+    printf("population: %zu\n", board_population(G->B));
+    if (G->stop_reason == STOP_CYCLE) {
+        if (G->cycle->start_min < G->cycle->start) {                // the boards in between were skipped by the update
+            printf("stop reason: cycle of period %zu (began between generations %zu and %zu)\n",
+                   G->cycle->period, G->cycle->start_min, G->cycle->start);
+        } else {
+            printf("stop reason: cycle of period %zu (began at generation %zu)\n", G->cycle->period, G->cycle->start);
+        }
     } else {
-        mvprintw(1, 0, "GAME OVER: Max iterations reached. Press any key to exit.");
-        clrtoeol();
+        printf("stop reason: %s\n", stop_reason_name(G->stop_reason));
+    }
+    printf("elapsed: %.3f s\n", secs);
+    printf("throughput: %.4g cells/s\n", secs > 0 ? (double)G->n_rows * G->n_cols * G->generation / secs : 0.0);
+    printf("allocations while running: %zu\n", game_alloc_count() - allocs);
+    if (G->perf) {
+        printf("time in game_update: %.0f ns/generation\n", perf_ns_per_gen(G->perf));
+    }
+    if (G->engine == ENGINE_SPARSE) {
+        printf("chunks: %zu live, %zu peak (%zu KiB)\n", G->sparse->n_chunks, G->sparse->peak_chunks,
+               G->sparse->peak_chunks * sizeof(chunk) / 1024);
     }
+}
 
-    return 0;
+
+/*
+    Runs a soup search with the board size, geometry, engine, rule and maxiters of G and prints the totals
+    to stderr (stdout only receives the per-soup CSV lines)
+    n_soups: # of soups
+    density, seed: soup k is a random board of this density seeded with seed + k
+    threads: # of worker threads
+*/
+static
+void run_soups(const game_state* G, size_t n_soups, double density, uint64_t seed, size_t threads) {
+    soup_params P = {
+        .n_rows = G->n_rows, .n_cols = G->n_cols, .maxiters = G->maxiters, .toroidal = G->toroidal,
+        .engine = G->engine, .rule = G->rule, .density = density, .seed = seed,
+        .n_soups = n_soups, .n_workers = threads,
+    };
+    soup_stats S;
+    soup_search(&P, stdout, &S);
+
+    fprintf(stderr, "soups: %zu in %.3f s (%.1f soups/s)\n", S.soups, S.secs, S.secs > 0 ? S.soups / S.secs : 0.0);
+    fprintf(stderr, "stop reasons: %zu steady state, %zu cycle, %zu max iterations reached\n",
+            S.stops[STOP_STEADY], S.stops[STOP_CYCLE], S.stops[STOP_MAXITERS]);
+    fprintf(stderr, "generations: %zu (%.4g cells/s)\n", S.generations,
+            S.secs > 0 ? (double)G->n_rows * G->n_cols * S.generations / S.secs : 0.0);
+    fprintf(stderr, "steals: %zu\n", S.steals);
+}
+
+
+/*
+    Runs the board of a checkpoint file out of core (see stream_run) and prints a summary
+    path: board file, created as a random board of rows x cols when density > 0
+    rulestring: rule of the run (NULL: the rule of the file, or B3/S23 for a new file)
+    budget_mb: memory budget of the board window
+    returns: exit status of the program
+*/
+static
+int run_stream(const char* path, size_t rows, size_t cols, bool toroidal, const char* rulestring,
+               double density, uint64_t seed, size_t maxiters, size_t budget_mb) {
+    checkpoint_header ck;
+    if (density <= 0 && !read_checkpoint_header(path, &ck)) {
+        fprintf(stderr, "%s: not a checkpoint file (use -r to create a random board)\n", path);
+        return EXIT_FAILURE;
+    }
+    if (density <= 0 && !rulestring) {
+        rulestring = ck.rule;
+    }
+    stream_params P = { .path = path, .maxiters = maxiters, .budget = budget_mb << 20 };
+    rule_init(&P.rule, RULE_LIFE_BIRTH, RULE_LIFE_SURVIVE);
+    if (rulestring && !parse_rule(rulestring, &P.rule)) {
+        fprintf(stderr, "%s: unsupported rule (expected e.g. B36/S23, B0 rules are not supported)\n", rulestring);
+        return EXIT_FAILURE;
+    }
+    if (density > 0 && !stream_create(path, rows, cols, toroidal, &P.rule, density, seed)) {
+        fprintf(stderr, "%s: could not create the board file\n", path);
+        return EXIT_FAILURE;
+    }
+
+    stream_stats S;
+    if (!stream_run(&P, &S)) {
+        fprintf(stderr, "%s: not a checkpoint file\n", path);
+        return EXIT_FAILURE;
+    }
+    char rule[32];
+    rule_name(&P.rule, rule, sizeof(rule));
+    double mb = 1024.0 * 1024.0;
+    printf("rule: %s\n", rule);
+    printf("board: %zu x %zu, %zu rows per band, %.1f MiB resident\n", S.n_rows, S.n_cols, S.band_rows, S.window_bytes / mb);
+    printf("generations: %zu\n", S.generation);
+    if (S.steps) {                                              // only known once a generation has streamed by
+        printf("population: %zu\n", S.population);
+    }
+    if (S.stop_reason == STOP_FAILED) {
+        printf("stop reason: %s\n", S.error);
+    } else {
+        printf("stop reason: %s\n", stop_reason_name(S.stop_reason));
+    }
+    printf("elapsed: %.3f s\n", S.secs);
+    printf("throughput: %.4g cells/s\n", S.secs > 0 ? (double)S.n_rows * S.n_cols * S.steps / S.secs : 0.0);
+    printf("read: %.1f MiB, %.1f MiB/s (%.1f MiB/s while reading)\n", S.bytes_read / mb,
+           S.secs > 0 ? S.bytes_read / mb / S.secs : 0.0, S.read_ns ? S.bytes_read / mb / (S.read_ns * 1e-9) : 0.0);
+    printf("written: %.1f MiB, %.1f MiB/s (%.1f MiB/s while writing)\n", S.bytes_written / mb,
+           S.secs > 0 ? S.bytes_written / mb / S.secs : 0.0, S.write_ns ? S.bytes_written / mb / (S.write_ns * 1e-9) : 0.0);
+    printf("waiting for I/O: %.3f s\n", S.stall_ns * 1e-9);
+    return S.stop_reason == STOP_FAILED ? EXIT_FAILURE : EXIT_SUCCESS;
 }
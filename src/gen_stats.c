@@ -0,0 +1,154 @@
+/*
+ -------------------------------------
+ File:    gen_stats.c
+ Project: conway-game-of-life
+ Per-generation statistics log written by a background thread
+ -------------------------------------
+ Author:  Akshath Wikramanayake
+ Email:   akshath.wikramanayake@gmail.com
+ Version  0.0.1
+ -------------------------------------
+ */
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+
+#include "life_functions.h"
+#include "gen_stats.h"
+
+
+/*
+    Writes the records of one buffer to the log file
+*/
+static
+void write_records(stats_writer* W, const gen_stats* recs, size_t n) {
+    if (W->binary) {
+        fwrite(recs, sizeof(gen_stats), n, W->file);
+        return;
+    }
+    for (size_t k = 0; k < n; k++) {
+        const gen_stats* s = &recs[k];
+        fprintf(W->file, "%llu,%llu,%llu,%llu,%lld,%lld,%lld,%lld\n",
+                (unsigned long long)s->generation, (unsigned long long)s->population,
+                (unsigned long long)s->births, (unsigned long long)s->deaths,
+                (long long)s->top, (long long)s->left, (long long)s->bottom, (long long)s->right);
+    }
+}
+
+
+static
+void* writer_thread(void* Wv) {
+    stats_writer* W = Wv;
+    while (true) {
+        pthread_mutex_lock(&W->mtx);
+        while (!W->quit && atomic_load(&W->consumed) == atomic_load(&W->produced)) {
+            pthread_cond_wait(&W->cond, &W->mtx);
+        }
+        bool quit = W->quit;
+        pthread_mutex_unlock(&W->mtx);
+
+        size_t produced = atomic_load(&W->produced);                // acquire: the records of the handed-over buffers
+        for (size_t k = atomic_load(&W->consumed); k < produced; k++) {
+            size_t slot = k % STATS_BUFFERS;
+            write_records(W, W->buffers[slot], W->fills[slot]);
+            atomic_store(&W->consumed, k + 1);                      // release: the buffer can be filled again
+        }
+        if (quit && atomic_load(&W->consumed) == atomic_load(&W->produced)) {
+            break;
+        }
+    }
+    return 0;
+}
+
+
+stats_writer* create_stats_writer(const char* path) {
+    size_t len = strlen(path);
+    bool binary = (len >= 4 && !strcmp(path + len - 4, ".bin"));
+    FILE* f = fopen(path, binary ? "wb" : "w");
+    if (!f) {
+        return NULL;
+    }
+    if (binary) {
+        uint32_t head[2] = { STATS_VERSION, sizeof(gen_stats) };
+        fwrite(STATS_MAGIC, 1, 8, f);
+        fwrite(head, sizeof(uint32_t), 2, f);
+    } else {
+        fprintf(f, "generation,population,births,deaths,top,left,bottom,right\n");
+    }
+
+    stats_writer* W = game_malloc(sizeof(stats_writer));
+    W->file = f;
+    W->binary = binary;
+    for (size_t k = 0; k < STATS_BUFFERS; k++) {
+        W->buffers[k] = game_malloc(STATS_BATCH * sizeof(gen_stats));
+        W->fills[k] = 0;
+    }
+    W->fill = 0;
+    W->produced = 0;
+    W->consumed = 0;
+    pthread_mutex_init(&W->mtx, 0);
+    pthread_cond_init(&W->cond, 0);
+    W->quit = false;
+    W->logged = 0;
+    W->dropped = 0;
+    pthread_create(&W->thread, 0, writer_thread, W);
+    return W;
+}
+
+
+/*
+    Hands the buffer being filled to the writer if a free buffer is left to continue in
+    wait: true: wait for a free buffer | false: drop the records if there is none
+*/
+static
+void hand_over(stats_writer* W, bool wait) {
+    size_t produced = atomic_load(&W->produced);
+    while (produced + 1 - atomic_load(&W->consumed) >= STATS_BUFFERS) {   // the next buffer is still queued
+        if (!wait) {
+            W->dropped += W->fill;
+            W->fill = 0;                                            // refill the same buffer
+            return;
+        }
+        sched_yield();
+    }
+    W->fills[produced % STATS_BUFFERS] = W->fill;
+    atomic_store(&W->produced, produced + 1);                       // release: the records are visible to the writer
+    W->fill = 0;
+    pthread_mutex_lock(&W->mtx);                                    // only held by the writer while it checks the ring
+    pthread_cond_signal(&W->cond);
+    pthread_mutex_unlock(&W->mtx);
+}
+
+
+void stats_push(stats_writer* W, const gen_stats* s) {
+    W->buffers[atomic_load_explicit(&W->produced, memory_order_relaxed) % STATS_BUFFERS][W->fill++] = *s;
+    W->logged++;
+    if (W->fill == STATS_BATCH) {
+        hand_over(W, false);
+    }
+}
+
+
+void destroy_stats_writer(stats_writer* W) {
+    if (W->fill) {
+        hand_over(W, true);
+    }
+    pthread_mutex_lock(&W->mtx);
+    W->quit = true;
+    pthread_cond_signal(&W->cond);
+    pthread_mutex_unlock(&W->mtx);
+    pthread_join(W->thread, 0);
+    pthread_cond_destroy(&W->cond);
+    pthread_mutex_destroy(&W->mtx);
+    fclose(W->file);
+    for (size_t k = 0; k < STATS_BUFFERS; k++) {
+        free(W->buffers[k]);
+    }
+    free(W);
+}
@@ -0,0 +1,90 @@
+/*
+ -------------------------------------
+ File:    gen_stats.h
+ Project: conway-game-of-life
+ Header for the per-generation statistics log
+ -------------------------------------
+ Author:  Akshath Wikramanayake
+ Email:   akshath.wikramanayake@gmail.com
+ Version  0.0.1
+ -------------------------------------
+ */
+
+#ifndef GEN_STATS_H
+#define GEN_STATS_H
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include <stdatomic.h>
+
+#include "life_functions.h"
+
+#define STATS_MAGIC "LIFESTAT"
+#define STATS_VERSION 1
+#define STATS_BATCH 4096                // # of records per buffer handed to the writer thread
+#define STATS_BUFFERS 4                 // # of buffers (one being filled, the others queued or being written)
+
+
+/*
+    Statistics of one generation of the board (of the board window for the unbounded engines).
+    Binary logs are the header "LIFESTAT", uint32 version, uint32 record size, then one record per generation
+    exactly as laid out here (little-endian).
+*/
+typedef struct _gen_stats {
+    uint64_t generation;
+    uint64_t population;        // # of living tiles
+    uint64_t births;            // # of tiles that came to life in the last update
+    uint64_t deaths;            // # of tiles that died in the last update
+    int64_t top, left;          // bounding box of the living tiles (all -1: empty board)
+    int64_t bottom, right;
+} gen_stats;
+
+
+/*
+    Background statistics writer. The update thread appends records to a buffer; full buffers are handed to
+    the writer thread through a single-producer/single-consumer ring of STATS_BUFFERS buffers, so logging
+    never waits for the disk. If every buffer is still queued, the records of the full buffer are dropped.
+*/
+typedef struct _stats_writer {
+    FILE* file;
+    bool binary;                // true: binary records | false: CSV
+    gen_stats* buffers[STATS_BUFFERS];
+    size_t fills[STATS_BUFFERS];    // # of records in each handed-over buffer
+    size_t fill;                // # of records in the buffer being filled (buffers[produced % STATS_BUFFERS])
+    atomic_size_t produced;     // # of buffers handed to the writer
+    atomic_size_t consumed;     // # of buffers written
+
+    pthread_t thread;
+    pthread_mutex_t mtx;        // protects quit, used with cond to wake the writer
+    pthread_cond_t cond;        // signalled when a buffer is handed over
+    bool quit;                  // set to true to make the writer exit once the ring is empty
+
+    size_t logged;              // # of records appended
+    size_t dropped;             // # of records dropped because the writer fell behind
+} stats_writer;
+
+
+/*
+    Opens the log file, writes its header and starts the writer thread
+    path: log file (binary if the name ends in ".bin", CSV otherwise)
+    returns: pointer to the new writer | NULL if the file could not be opened
+*/
+stats_writer* create_stats_writer(const char* path);
+
+
+/*
+    Hands over the records still buffered, waits for the writer to write them, stops it, closes the file
+    and deallocates the writer
+*/
+void destroy_stats_writer(stats_writer*);
+
+
+/*
+    Appends the record of one generation (update thread only). Never blocks.
+*/
+void stats_push(stats_writer*, const gen_stats* s);
+
+#endif
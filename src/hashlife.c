@@ -0,0 +1,485 @@
+/*
+ -------------------------------------
+ File:    hashlife.c
+ Project: conway-game-of-life
+ Hashlife engine: canonical quadtree with memoised macro-steps
+ -------------------------------------
+ Author:  Akshath Wikramanayake
+ Email:   akshath.wikramanayake@gmail.com
+ Version  0.0.1
+ -------------------------------------
+ */
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <setjmp.h>
+
+#include "life_functions.h"
+#include "hashlife.h"
+
+
+static inline
+uint32_t hash_children(uint32_t nw, uint32_t ne, uint32_t sw, uint32_t se) {
+    uint64_t h = nw * 0x9E3779B97F4A7C15ull;
+    h = (h ^ ne) * 0xC2B2AE3D27D4EB4Full;
+    h = (h ^ sw) * 0x165667B19E3779F9ull;
+    h = (h ^ se) * 0x9E3779B97F4A7C15ull;
+    return (uint32_t)(h >> 32);
+}
+
+
+/*
+    Content hash of a node from the content hashes of its children: unlike node ids, it does not change
+    when the garbage collector frees a node and join creates it again elsewhere in the arena
+*/
+static inline
+uint64_t hash_content(uint64_t nw, uint64_t ne, uint64_t sw, uint64_t se) {
+    uint64_t h = (nw + 0x9E3779B97F4A7C15ull) * 0xC2B2AE3D27D4EB4Full;
+    h = (h ^ (h >> 29) ^ ne) * 0x165667B19E3779F9ull;
+    h = (h ^ (h >> 32) ^ sw) * 0x9E3779B97F4A7C15ull;
+    h = (h ^ (h >> 29) ^ se) * 0xC2B2AE3D27D4EB4Full;
+    return h ^ (h >> 32);
+}
+
+
+/*
+    Returns the canonical node with the given children, creating it if needed.
+    Jumps to hl->oom if the arena is full.
+*/
+static
+uint32_t join(hashlife* hl, uint32_t nw, uint32_t ne, uint32_t sw, uint32_t se) {
+    uint32_t* head = &hl->buckets[hash_children(nw, ne, sw, se) & (hl->n_buckets - 1)];
+    for (uint32_t k = *head; k != HL_NONE; k = hl->nodes[k].next) {
+        hl_node* n = &hl->nodes[k];
+        if (n->nw == nw && n->ne == ne && n->sw == sw && n->se == se) {
+            return k;
+        }
+    }
+
+    uint32_t k;
+    if (hl->free_list != HL_NONE) {                                 // reuse a node freed by the garbage collector
+        k = hl->free_list;
+        hl->free_list = hl->nodes[k].next;
+    } else if (hl->n_used < hl->capacity) {
+        k = hl->n_used++;
+    } else {
+        longjmp(hl->oom, 1);                                        // budget exhausted: collect garbage and retry
+    }
+
+    hl_node* n = &hl->nodes[k];
+    n->nw = nw;
+    n->ne = ne;
+    n->sw = sw;
+    n->se = se;
+    n->result = HL_NONE;
+    n->pop = hl->nodes[nw].pop + hl->nodes[ne].pop + hl->nodes[sw].pop + hl->nodes[se].pop;
+    n->level = hl->nodes[nw].level + 1;
+    n->hash = hash_content(hl->nodes[nw].hash, hl->nodes[ne].hash, hl->nodes[sw].hash, hl->nodes[se].hash);
+    n->mark = 0;
+    n->next = *head;
+    *head = k;
+    hl->n_live++;
+    return k;
+}
+
+
+/*
+    Centre (level k - 1) of a level k node
+*/
+static inline
+uint32_t centre(hashlife* hl, uint32_t k) {
+    hl_node* n = &hl->nodes[k];
+    return join(hl, hl->nodes[n->nw].se, hl->nodes[n->ne].sw, hl->nodes[n->sw].ne, hl->nodes[n->se].nw);
+}
+
+
+/*
+    Node straddling two horizontally adjacent nodes w | e (same level as w and e)
+*/
+static inline
+uint32_t centre_h(hashlife* hl, uint32_t w, uint32_t e) {
+    hl_node* W = &hl->nodes[w];
+    hl_node* E = &hl->nodes[e];
+    return join(hl, W->ne, E->nw, W->se, E->sw);
+}
+
+
+/*
+    Node straddling two vertically adjacent nodes n over s (same level as n and s)
+*/
+static inline
+uint32_t centre_v(hashlife* hl, uint32_t n, uint32_t s) {
+    hl_node* N = &hl->nodes[n];
+    hl_node* S = &hl->nodes[s];
+    return join(hl, N->sw, N->se, S->nw, S->ne);
+}
+
+
+/*
+    Base case: advances the centre 2x2 cells of a 4x4 (level 2) node by one generation
+*/
+static
+uint32_t step_leaf(hashlife* hl, uint32_t k) {
+    hl_node* n = &hl->nodes[k];
+    uint32_t q[4] = { n->nw, n->ne, n->sw, n->se };
+    bool cell[4][4];
+    for (int c = 0; c < 4; c++) {                                   // gather the 16 cells from the 4 level 1 children
+        hl_node* ch = &hl->nodes[q[c]];
+        int y = (c / 2) * 2;
+        int x = (c % 2) * 2;
+        cell[y][x] = ch->nw;
+        cell[y][x + 1] = ch->ne;
+        cell[y + 1][x] = ch->sw;
+        cell[y + 1][x + 1] = ch->se;
+    }
+
+    uint32_t r[4];
+    for (int y = 1; y < 3; y++) {
+        for (int x = 1; x < 3; x++) {
+            size_t nbrs = 0;
+            for (int dy = -1; dy <= 1; dy++) {
+                for (int dx = -1; dx <= 1; dx++) {
+                    nbrs += (dy || dx) && cell[y + dy][x + dx];
+                }
+            }
+            r[(y - 1) * 2 + (x - 1)] = test_life(&hl->rule, cell[y][x], nbrs);
+        }
+    }
+    return join(hl, r[0], r[1], r[2], r[3]);
+}
+
+
+/*
+    Returns the centre (level k - 1) of a level k node advanced by 2^min(step_log2, k - 2) generations.
+    Results are memoised in the node.
+*/
+static
+uint32_t step(hashlife* hl, uint32_t k) {
+    hl_node* n = &hl->nodes[k];
+    if (n->result != HL_NONE) {
+        return n->result;
+    }
+
+    uint32_t res;
+    int level = n->level;
+    if (n->pop == 0) {
+        res = hl->empty[level - 1];
+    } else if (level == 2) {
+        res = step_leaf(hl, k);
+    } else {
+        uint32_t nw = n->nw, ne = n->ne, sw = n->sw, se = n->se;
+        // 9 overlapping level k - 1 subsquares
+        uint32_t s[9] = {
+            nw,                  centre_h(hl, nw, ne),  ne,
+            centre_v(hl, nw, sw), centre(hl, k),         centre_v(hl, ne, se),
+            sw,                  centre_h(hl, sw, se),  se,
+        };
+        bool fast = (hl->step_log2 >= level - 2);                   // full speed: both halves of the step advance time
+        for (int i = 0; i < 9; i++) {
+            s[i] = fast ? step(hl, s[i]) : centre(hl, s[i]);
+        }
+        uint32_t a = step(hl, join(hl, s[0], s[1], s[3], s[4]));
+        uint32_t b = step(hl, join(hl, s[1], s[2], s[4], s[5]));
+        uint32_t c = step(hl, join(hl, s[3], s[4], s[6], s[7]));
+        uint32_t d = step(hl, join(hl, s[4], s[5], s[7], s[8]));
+        res = join(hl, a, b, c, d);
+    }
+    n->result = res;                                                // the arena never moves, so n is still valid
+    return res;
+}
+
+
+/*
+    Surrounds the root with empty space, doubling its size (the origin stays in the centre)
+*/
+static
+void expand(hashlife* hl) {
+    hl_node* r = &hl->nodes[hl->root];
+    uint32_t e = hl->empty[r->level - 1];
+    uint32_t nw = r->nw, ne = r->ne, sw = r->sw, se = r->se;
+    hl->root = join(hl,
+        join(hl, e, e, e, nw), join(hl, e, e, ne, e),
+        join(hl, e, sw, e, e), join(hl, se, e, e, e));
+}
+
+
+/*
+    true if every living cell of the root lies in its centre quarter
+*/
+static
+bool root_is_padded(const hashlife* hl) {
+    const hl_node* N = hl->nodes;
+    const hl_node* r = &N[hl->root];
+    return N[r->nw].pop == N[N[N[r->nw].se].se].pop
+        && N[r->ne].pop == N[N[N[r->ne].sw].sw].pop
+        && N[r->sw].pop == N[N[N[r->sw].ne].ne].pop
+        && N[r->se].pop == N[N[N[r->se].nw].nw].pop;
+}
+
+
+static
+void clear_results(hashlife* hl) {
+    for (size_t k = 0; k < hl->n_used; k++) {
+        hl->nodes[k].result = HL_NONE;
+    }
+}
+
+
+static
+void mark(hashlife* hl, uint32_t k) {
+    hl_node* n = &hl->nodes[k];
+    if (n->mark) {
+        return;
+    }
+    n->mark = 1;
+    if (n->level > 0) {
+        mark(hl, n->nw);
+        mark(hl, n->ne);
+        mark(hl, n->sw);
+        mark(hl, n->se);
+    }
+}
+
+
+/*
+    Garbage collection: drops the memoised results and frees every node that is not part of the current
+    universe, the generation 0 universe or the empty nodes
+*/
+static
+void collect(hashlife* hl) {
+    clear_results(hl);
+    mark(hl, hl->root);
+    mark(hl, hl->origin);
+    for (int l = 0; l <= HL_MAX_LEVEL; l++) {
+        mark(hl, hl->empty[l]);
+    }
+
+    for (size_t b = 0; b < hl->n_buckets; b++) {
+        hl->buckets[b] = HL_NONE;
+    }
+    hl->free_list = HL_NONE;
+    hl->n_live = 2;
+    for (size_t k = hl->n_used; k-- > 2; ) {                        // rebuild the hash table from the surviving nodes
+        hl_node* n = &hl->nodes[k];
+        if (n->mark) {
+            uint32_t* head = &hl->buckets[hash_children(n->nw, n->ne, n->sw, n->se) & (hl->n_buckets - 1)];
+            n->next = *head;
+            *head = k;
+            n->mark = 0;
+            hl->n_live++;
+        } else {
+            n->next = hl->free_list;
+            hl->free_list = k;
+        }
+    }
+    hl->nodes[0].mark = 0;
+    hl->nodes[1].mark = 0;
+    hl->gc_runs++;
+}
+
+
+hashlife* create_hashlife(size_t budget, const life_rule* rule) {
+    hashlife* hl = game_malloc(sizeof(hashlife));
+    hl->rule = *rule;
+
+    size_t cap = budget / (sizeof(hl_node) + sizeof(uint32_t));    // node + its share of the hash table
+    if (cap < 1024) cap = 1024;
+    if (cap > HL_NONE / 2) cap = HL_NONE / 2;
+    hl->n_buckets = 1;
+    while (hl->n_buckets * 2 <= cap) {                              // at most 1 bucket per node
+        hl->n_buckets *= 2;
+    }
+    hl->capacity = cap;
+
+    hl->nodes = game_malloc(hl->capacity * sizeof(hl_node));
+    hl->buckets = game_malloc(hl->n_buckets * sizeof(uint32_t));
+    for (size_t b = 0; b < hl->n_buckets; b++) {
+        hl->buckets[b] = HL_NONE;
+    }
+
+    for (uint32_t k = 0; k < 2; k++) {                              // the two cells
+        hl->nodes[k] = (hl_node){ 0, 0, 0, 0, HL_NONE, HL_NONE, k, k ? 0x9E3779B97F4A7C15ull : 0, 0, 0 };
+    }
+    hl->n_used = 2;
+    hl->n_live = 2;
+    hl->free_list = HL_NONE;
+    hl->gc_runs = 0;
+    hl->step_log2 = -1;
+    hl->generation = 0;
+
+    if (setjmp(hl->oom)) {                                          // the arena can always hold the empty nodes
+        abort();
+    }
+    hl->empty[0] = 0;
+    for (int l = 1; l <= HL_MAX_LEVEL; l++) {
+        uint32_t e = hl->empty[l - 1];
+        hl->empty[l] = join(hl, e, e, e, e);
+    }
+    hl->root = hl->empty[3];
+    hl->origin = hl->root;
+    return hl;
+}
+
+
+void destroy_hashlife(hashlife* hl) {
+    free(hl->buckets);
+    free(hl->nodes);
+    free(hl);
+}
+
+
+/*
+    Builds the node for the 2^level square with top-left corner (y0, x0) from the board
+*/
+static
+uint32_t build(hashlife* hl, const board* B, int level, int64_t y0, int64_t x0) {
+    int64_t size = (int64_t)1 << level;
+    if (y0 >= (int64_t)B->n_rows || x0 >= (int64_t)B->n_cols || y0 + size <= 0 || x0 + size <= 0) {
+        return hl->empty[level];                                    // square lies outside the board
+    }
+    if (level == 0) {
+        return get_cell(B, y0, x0);
+    }
+    if (level == 6 && x0 >= 0) {                                    // 64 x 64 squares are word aligned: skip empty ones quickly
+        bool empty = true;
+        for (int64_t y = (y0 < 0 ? 0 : y0); y < y0 + size && y < (int64_t)B->n_rows && empty; y++) {
+            empty = (board_row(B, y + 1)[(x0 >> 6) + 1] == 0);
+        }
+        if (empty) {
+            return hl->empty[level];
+        }
+    }
+    int64_t h = size / 2;
+    return join(hl,
+        build(hl, B, level - 1, y0, x0), build(hl, B, level - 1, y0, x0 + h),
+        build(hl, B, level - 1, y0 + h, x0), build(hl, B, level - 1, y0 + h, x0 + h));
+}
+
+
+bool hashlife_load(hashlife* hl, const board* B) {
+    int level = 3;
+    size_t extent = (B->n_rows > B->n_cols) ? B->n_rows : B->n_cols;
+    while (((size_t)1 << (level - 1)) < extent) {                   // root spans [-2^(level-1), 2^(level-1)) on both axes
+        level++;
+    }
+
+    hl->root = hl->empty[3];                                        // drop the old universe before building the new one
+    hl->origin = hl->root;
+    hl->generation = 0;
+    collect(hl);
+    if (setjmp(hl->oom)) {                                          // the board alone does not fit in the budget
+        collect(hl);
+        return false;
+    }
+    int64_t half = (int64_t)1 << (level - 1);
+    hl->root = build(hl, B, level, -half, -half);
+    hl->origin = hl->root;
+    return true;
+}
+
+
+/*
+    Sets the step size of the memoised results, clearing them if it changes
+*/
+static
+void set_step(hashlife* hl, int j) {
+    if (hl->step_log2 != j) {
+        clear_results(hl);
+        hl->step_log2 = j;
+    }
+}
+
+
+/*
+    Advances the universe by 2^j generations, collecting garbage (and if needed, splitting the step)
+    whenever the arena fills up
+*/
+static
+bool advance_pow2(hashlife* hl, int j) {
+    volatile int attempts = 0;
+    if (hl->n_live > hl->capacity - hl->capacity / 4) {             // collect early rather than in the middle of a step
+        collect(hl);
+    }
+    if (setjmp(hl->oom)) {
+        collect(hl);
+        set_step(hl, j);
+        if (++attempts > 1) {                                       // a fresh cache was not enough: take two half steps
+            return j > 0 && advance_pow2(hl, j - 1) && advance_pow2(hl, j - 1);
+        }
+    }
+    set_step(hl, j);
+    while (hl->nodes[hl->root].level < j + 3 || !root_is_padded(hl)) {
+        expand(hl);
+    }
+    hl->root = step(hl, hl->root);
+    hl->generation += (uint64_t)1 << j;
+    return true;
+}
+
+
+bool hashlife_advance(hashlife* hl, uint64_t gens) {
+    for (int j = 63; j >= 0; j--) {                                 // one macro-step per set bit, largest first
+        if ((gens >> j) & 1) {
+            if (!advance_pow2(hl, j)) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+
+bool hashlife_seek(hashlife* hl, uint64_t generation) {
+    if (generation < hl->generation) {
+        hl->root = hl->origin;
+        hl->generation = 0;
+    }
+    return hashlife_advance(hl, generation - hl->generation);
+}
+
+
+/*
+    Sets the living cells of the node for the 2^level square with top-left corner (y0, x0) on the board
+*/
+static
+void extract(const hashlife* hl, uint32_t k, board* B, int64_t y0, int64_t x0) {
+    const hl_node* n = &hl->nodes[k];
+    int64_t size = (int64_t)1 << n->level;
+    if (n->pop == 0 || y0 >= (int64_t)B->n_rows || x0 >= (int64_t)B->n_cols || y0 + size <= 0 || x0 + size <= 0) {
+        return;
+    }
+    if (n->level == 0) {
+        set_cell(B, y0, x0, true);
+        return;
+    }
+    int64_t h = size / 2;
+    extract(hl, n->nw, B, y0, x0);
+    extract(hl, n->ne, B, y0, x0 + h);
+    extract(hl, n->sw, B, y0 + h, x0);
+    extract(hl, n->se, B, y0 + h, x0 + h);
+}
+
+
+uint64_t hashlife_hash(const hashlife* hl) {
+    const hl_node* N = hl->nodes;
+    const hl_node* r = &N[hl->root];
+    uint32_t q[4] = { r->nw, r->ne, r->sw, r->se };                 // children of the square, cropped without joining
+    int level = r->level;
+    while (level > 2
+        && N[q[0]].pop == N[N[N[q[0]].se].se].pop && N[q[1]].pop == N[N[N[q[1]].sw].sw].pop
+        && N[q[2]].pop == N[N[N[q[2]].ne].ne].pop && N[q[3]].pop == N[N[N[q[3]].nw].nw].pop) {
+        uint32_t c[4] = { N[q[0]].se, N[q[1]].sw, N[q[2]].ne, N[q[3]].nw };     // children of the centre
+        memcpy(q, c, sizeof(q));
+        level--;
+    }
+    return hash_content(N[q[0]].hash, N[q[1]].hash, N[q[2]].hash, N[q[3]].hash) ^ (uint64_t)level;
+}
+
+
+void hashlife_extract(const hashlife* hl, board* B) {
+    memset(B->data, 0, (B->n_rows + 2) * B->stride * sizeof(uint64_t));
+    int64_t half = (int64_t)1 << (hl->nodes[hl->root].level - 1);
+    extract(hl, hl->root, B, -half, -half);
+}
@@ -0,0 +1,112 @@
+/*
+ -------------------------------------
+ File:    hashlife.h
+ Project: conway-game-of-life
+ Header for the Hashlife engine
+ -------------------------------------
+ Author:  Akshath Wikramanayake
+ Email:   akshath.wikramanayake@gmail.com
+ Version  0.0.1
+ -------------------------------------
+ */
+
+#ifndef HASHLIFE_H
+#define HASHLIFE_H
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <setjmp.h>
+
+#include "life_functions.h"
+
+#define HL_NONE UINT32_MAX             // marks a missing memoised result / end of a hash chain
+#define HL_MAX_LEVEL 62
+
+
+/*
+    Canonical quadtree node. A level k node is a 2^k x 2^k square; level 0 nodes are single cells
+    (node 0: dead, node 1: alive). Nodes are unique: two nodes with the same children are the same node.
+*/
+typedef struct _hl_node {
+    uint32_t nw, ne, sw, se;    // children (level - 1)
+    uint32_t result;            // memoised centre (level - 1) advanced by the current step, HL_NONE if not computed
+    uint32_t next;              // next node in the hash chain / free list
+    uint64_t pop;               // # of living cells
+    uint64_t hash;              // hash of the cells (equal squares have equal hashes, wherever they lie)
+    uint8_t level;
+    uint8_t mark;               // used by the garbage collector
+} hl_node;
+
+
+typedef struct _hashlife {
+    hl_node* nodes;             // node arena, never grows past the memory budget
+    size_t capacity;            // # of nodes that fit in the arena
+    size_t n_used;              // # of arena slots handed out so far (slots past this are untouched)
+    size_t n_live;              // # of nodes currently in use
+    uint32_t free_list;         // nodes freed by the garbage collector
+    uint32_t* buckets;          // hash table of canonical nodes (heads of the chains)
+    size_t n_buckets;           // power of 2
+
+    uint32_t empty[HL_MAX_LEVEL + 1];   // empty node of each level
+    uint32_t root;              // current universe, centred on the origin
+    uint32_t origin;            // universe at generation 0 (kept so earlier generations can be revisited)
+    int step_log2;              // memoised results advance 2^step_log2 generations (-1: no results)
+    uint64_t generation;        // generation of root
+
+    life_rule rule;             // birth/survival rule (B0 rules are not supported: empty space must stay empty)
+    size_t gc_runs;             // # of garbage collections run so far
+    jmp_buf oom;                // jumped to when the arena is full during a step
+} hashlife;
+
+
+/*
+    Allocates a Hashlife universe whose node arena and hash table fit in the given memory budget
+    budget: memory budget in bytes
+    rule: birth/survival rule the universe evolves under
+    returns: pointer to the new universe
+*/
+hashlife* create_hashlife(size_t budget, const life_rule* rule);
+
+
+/*
+    Deallocates a Hashlife universe
+*/
+void destroy_hashlife(hashlife*);
+
+
+/*
+    Replaces the universe with the contents of the board (cell (i, j) of the board is cell (i, j) of the
+    universe) and makes it generation 0. The halo of the board is ignored: Hashlife simulates an unbounded plane.
+    returns: true on success | false if the board does not fit in the memory budget (the universe is left empty)
+*/
+bool hashlife_load(hashlife*, const board*);
+
+
+/*
+    Advances the universe by the given # of generations
+    returns: true on success | false if a single generation does not fit in the memory budget
+*/
+bool hashlife_advance(hashlife*, uint64_t gens);
+
+
+/*
+    Moves the universe to an arbitrary generation (earlier generations are recomputed from generation 0)
+    returns: true on success | false if the memory budget was exceeded
+*/
+bool hashlife_seek(hashlife*, uint64_t generation);
+
+
+/*
+    Hash of the whole universe, not just the window: the hash of the smallest centred square holding every
+    living cell (the root with its empty border cropped away), so it only depends on the cells and where they lie
+*/
+uint64_t hashlife_hash(const hashlife*);
+
+
+/*
+    Writes the window of the universe covered by the board (rows 0..n_rows-1, columns 0..n_cols-1) to the board
+*/
+void hashlife_extract(const hashlife*, board*);
+
+#endif
@@ -0,0 +1,491 @@
+/*
+ -------------------------------------
+ File:    history.c
+ Project: conway-game-of-life
+ Memory-bounded history of past generations: keyframes and per-update flip lists in a ring buffer
+ -------------------------------------
+ Author:  Akshath Wikramanayake
+ Email:   akshath.wikramanayake@gmail.com
+ Version  0.0.1
+ -------------------------------------
+ */
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdbool.h>
+
+#include "life_functions.h"
+#include "history.h"
+
+
+/*
+    # of bytes of the LEB128 varint of v
+*/
+static inline
+size_t varint_size(uint64_t v) {
+    size_t n = 1;
+    while (v >= 0x80) {
+        v >>= 7;
+        n++;
+    }
+    return n;
+}
+
+
+static inline
+uint8_t* put_varint(uint8_t* p, uint64_t v) {
+    while (v >= 0x80) {
+        *p++ = (uint8_t)(v | 0x80);
+        v >>= 7;
+    }
+    *p++ = (uint8_t)v;
+    return p;
+}
+
+
+static inline
+const uint8_t* get_varint(const uint8_t* p, uint64_t* v) {
+    uint64_t x = 0;
+    for (int s = 0; ; s += 7) {
+        uint8_t b = *p++;
+        x |= (uint64_t)(b & 0x7f) << s;
+        if (!(b & 0x80)) {
+            break;
+        }
+    }
+    *v = x;
+    return p;
+}
+
+
+static inline
+uint8_t* put_word(uint8_t* p, uint64_t v) {
+    for (int b = 0; b < 8; b++) {
+        p[b] = (uint8_t)(v >> (8 * b));
+    }
+    return p + 8;
+}
+
+
+static inline
+const uint8_t* get_word(const uint8_t* p, uint64_t* v) {
+    uint64_t x = 0;
+    for (int b = 0; b < 8; b++) {
+        x |= (uint64_t)p[b] << (8 * b);
+    }
+    *v = x;
+    return p + 8;
+}
+
+
+static inline
+history_record read_header(const history* H, size_t off) {
+    history_record h;
+    memcpy(&h, H->data + off, sizeof(h));
+    return h;
+}
+
+
+/*
+    Offset of the record that follows the record at off
+*/
+static inline
+size_t next_record(const history* H, size_t off) {
+    off += read_header(H, off).size;
+    return (H->wrapped && off == H->end) ? 0 : off;
+}
+
+
+/*
+    Empties the ring
+*/
+static
+void clear_records(history* H) {
+    H->head = 0;
+    H->tail = 0;
+    H->end = 0;
+    H->wrapped = false;
+    H->n_records = 0;
+    H->used = 0;
+    H->since_key = 0;
+    H->since_key_bytes = 0;
+    H->key_bytes = 0;
+}
+
+
+/*
+    Evicts the oldest segment: the keyframe at the head and the deltas that follow it
+*/
+static
+void evict_segment(history* H) {
+    do {
+        history_record h = read_header(H, H->head);
+        H->head = next_record(H, H->head);
+        if (H->wrapped && H->head == 0) {
+            H->wrapped = false;                                     // the records left are [0, tail)
+        }
+        H->used -= h.size;
+        H->n_records--;
+        H->evicted++;
+    } while (H->n_records && !read_header(H, H->head).key);
+    if (!H->n_records) {
+        clear_records(H);
+    } else {
+        H->first_gen = read_header(H, H->head).generation;
+    }
+}
+
+
+/*
+    Finds n contiguous free bytes at the tail of the ring, evicting the oldest segments as needed. The segment
+    of the newest keyframe is only evicted for a keyframe (a delta needs it).
+    returns: offset of the free bytes | SIZE_MAX if a delta does not fit next to its segment
+*/
+static
+size_t reserve(history* H, size_t n, bool key) {
+    while (true) {
+        if (!H->n_records) {
+            return 0;                                               // n <= size (see create_history)
+        }
+        if (!H->wrapped && H->size - H->tail >= n) {
+            return H->tail;
+        }
+        if (!H->wrapped && H->head >= n) {                          // wrap: the records before the end stay where they are
+            H->end = H->tail;
+            H->wrapped = true;
+            H->tail = 0;
+            return 0;
+        }
+        if (H->wrapped && H->head - H->tail >= n) {
+            return H->tail;
+        }
+        if (!key && H->n_records == H->since_key + 1) {             // only the newest segment is left
+            return SIZE_MAX;
+        }
+        evict_segment(H);
+    }
+}
+
+
+/*
+    Appends the record just written at off
+*/
+static
+void commit(history* H, size_t off, const history_record* h) {
+    memcpy(H->data + off, h, sizeof(*h));
+    if (!H->n_records) {
+        H->head = off;
+        H->first_gen = h->generation;
+    }
+    H->tail = off + h->size;
+    H->last = off;
+    H->n_records++;
+    H->used += h->size;
+    H->last_gen = h->generation;
+    if (h->key) {
+        H->since_key = 0;
+        H->since_key_bytes = 0;
+        H->key_bytes = h->size;
+        H->keys++;
+        H->key_total += h->size;
+    } else {
+        H->since_key++;
+        H->since_key_bytes += h->size;
+        H->deltas++;
+        H->delta_total += h->size;
+    }
+}
+
+
+/*
+    Records the whole board as a keyframe (diffed against an empty board)
+*/
+static
+void push_key(history* H, const game_state* G) {
+    const board* B = G->B;
+    uint64_t last_mask = last_word_mask(B);
+    size_t count = 0;
+    for (size_t i = 1; i < B->n_rows + 1; i++) {                    // counted first: the record is written in place
+        const uint64_t* row = board_row(B, i);
+        for (size_t w = 1; w < H->n_words + 1; w++) {
+            count += ((row[w] & ((w == H->n_words) ? last_mask : ~(uint64_t)0)) != 0);
+        }
+    }
+    size_t off = reserve(H, sizeof(history_record) + count * H->word_bytes, true);
+    uint8_t* p = H->data + off + sizeof(history_record);
+    size_t k = 0;
+    size_t prev = 0;                                                // index of the word after the last one written
+    for (size_t i = 1; i < B->n_rows + 1; i++) {
+        const uint64_t* row = board_row(B, i);
+        for (size_t w = 1; w < H->n_words + 1; w++, k++) {
+            uint64_t v = row[w] & ((w == H->n_words) ? last_mask : ~(uint64_t)0);
+            if (v) {
+                p = put_varint(p, k - prev);
+                p = put_word(p, v);
+                prev = k + 1;
+            }
+        }
+    }
+    history_record h = {
+        .generation = G->generation, .updates = G->updates, .count = count,
+        .size = (size_t)(p - (H->data + off)), .key = true,
+    };
+    commit(H, off, &h);
+}
+
+
+history* create_history(const game_state* G, size_t budget) {
+    size_t n_words = G->n_tile_cols;
+    size_t word_bytes = 8 + varint_size((uint64_t)G->n_rows * n_words);
+    if (budget < sizeof(history_record) + G->n_rows * n_words * word_bytes) {
+        return NULL;                                                // a keyframe of a full board would not fit
+    }
+    history* H = game_calloc(1, sizeof(history));                   // counters start at 0
+    H->data = game_malloc(budget);
+    H->size = budget;
+    H->n_words = n_words;
+    H->word_bytes = word_bytes;
+    H->cols = game_malloc(n_words * sizeof(size_t));
+    clear_records(H);
+    return H;
+}
+
+
+void destroy_history(history* H) {
+    free(H->data);
+    free(H->cols);
+    free(H);
+}
+
+
+/*
+    Drops the records of generation and later
+*/
+static
+void truncate_records(history* H, size_t generation) {
+    size_t off = H->head;
+    size_t kept = 0;
+    size_t used = 0;
+    size_t last = H->head;
+    size_t since_key = 0;
+    uint64_t since_key_bytes = 0;
+    uint64_t key_bytes = 0;
+    size_t last_gen = 0;
+    for (; kept < H->n_records; kept++) {
+        history_record h = read_header(H, off);
+        if (h.generation >= generation) {
+            break;
+        }
+        used += h.size;
+        last = off;
+        last_gen = h.generation;
+        if (h.key) {
+            since_key = 0;
+            since_key_bytes = 0;
+            key_bytes = h.size;
+        } else {
+            since_key++;
+            since_key_bytes += h.size;
+        }
+        off = next_record(H, off);
+    }
+    if (!kept) {
+        clear_records(H);
+        return;
+    }
+    if (kept == H->n_records) {
+        return;
+    }
+    if (H->wrapped && off >= H->head) {                             // the dropped records start before the wrap
+        H->wrapped = false;
+    }
+    H->tail = off;
+    H->n_records = kept;
+    H->used = used;
+    H->last = last;
+    H->since_key = since_key;
+    H->since_key_bytes = since_key_bytes;
+    H->key_bytes = key_bytes;
+    H->last_gen = last_gen;
+}
+
+
+void history_restart(history* H, const game_state* G) {
+    truncate_records(H, G->generation);
+    push_key(H, G);
+}
+
+
+void history_push(history* H, const game_state* G) {
+    if (!H->n_records || H->since_key + 1 >= HISTORY_KEY_INTERVAL || H->since_key_bytes >= H->key_bytes) {
+        push_key(H, G);                                             // bounds the replay of a seek and the bytes of a segment
+        return;
+    }
+    const board* B = G->B;                                          // the current generation
+    const board* old = G->next;                                     // the previous one (swapped by game_update)
+    uint64_t last_mask = last_word_mask(B);
+    size_t tc = G->n_tile_cols;
+    size_t count = 0;
+    for (size_t ty = 0; ty < G->n_tile_rows; ty++) {                // counted first: the record is written in place
+        const size_t* tile_gen = G->tile_gen + ty * tc;
+        size_t i1 = (ty + 1) * TILE_ROWS < B->n_rows ? (ty + 1) * TILE_ROWS : B->n_rows;
+        for (size_t x = 0; x < tc; x++) {
+            if (tile_gen[x] != G->generation) {
+                continue;
+            }
+            uint64_t mask = (x + 1 == tc) ? last_mask : ~(uint64_t)0;
+            for (size_t i = ty * TILE_ROWS + 1; i < i1 + 1; i++) {
+                count += (((board_row(B, i)[x + 1] ^ board_row(old, i)[x + 1]) & mask) != 0);
+            }
+        }
+    }
+    size_t bound = sizeof(history_record) + count * H->word_bytes;
+    if (H->since_key_bytes + bound > H->size / 2) {
+        push_key(H, G);                                             // the segment would not leave room for another one
+        return;
+    }
+    size_t off = reserve(H, bound, false);
+    if (off == SIZE_MAX) {
+        push_key(H, G);
+        return;
+    }
+
+    uint8_t* p = H->data + off + sizeof(history_record);
+    size_t prev = 0;                                                // index of the word after the last one written
+    for (size_t ty = 0; ty < G->n_tile_rows; ty++) {                // in board order: row by row, only the changed tiles
+        const size_t* tile_gen = G->tile_gen + ty * tc;
+        size_t n = 0;
+        for (size_t x = 0; x < tc; x++) {
+            if (tile_gen[x] == G->generation) {
+                H->cols[n++] = x;
+            }
+        }
+        size_t i1 = (ty + 1) * TILE_ROWS < B->n_rows ? (ty + 1) * TILE_ROWS : B->n_rows;
+        for (size_t i = ty * TILE_ROWS + 1; i < i1 + 1 && n; i++) {
+            const uint64_t* a = board_row(old, i);
+            const uint64_t* b = board_row(B, i);
+            for (size_t c = 0; c < n; c++) {
+                size_t x = H->cols[c];
+                uint64_t mask = (x + 1 == tc) ? last_mask : ~(uint64_t)0;
+                uint64_t diff = (a[x + 1] ^ b[x + 1]) & mask;
+                if (diff) {
+                    size_t k = (i - 1) * tc + x;
+                    p = put_varint(p, k - prev);
+                    p = put_word(p, diff);
+                    prev = k + 1;
+                }
+            }
+        }
+    }
+    history_record h = {
+        .generation = G->generation, .updates = G->updates, .count = count,
+        .size = (size_t)(p - (H->data + off)), .key = false,
+    };
+    commit(H, off, &h);
+}
+
+
+/*
+    XORs the changed words of a record into a board
+*/
+static
+void apply_record(const history* H, size_t off, board* out) {
+    history_record h = read_header(H, off);
+    const uint8_t* p = H->data + off + sizeof(history_record);
+    uint64_t k = 0;
+    for (uint64_t c = 0; c < h.count; c++) {
+        uint64_t gap, diff;
+        p = get_varint(p, &gap);
+        p = get_word(p, &diff);
+        k += gap;
+        board_row(out, k / H->n_words + 1)[k % H->n_words + 1] ^= diff;
+        k++;
+    }
+}
+
+
+bool history_seek(history* H, size_t generation, board* out, size_t* gen, size_t* updates) {
+    uint64_t t0 = clock_ns();
+    if (!H->n_records || generation < H->first_gen) {
+        return false;
+    }
+    size_t key = H->head;                                           // newest keyframe at or before the generation
+    size_t off = H->head;
+    for (size_t r = 0; r < H->n_records; r++) {
+        history_record h = read_header(H, off);
+        if (h.generation > generation) {
+            break;
+        }
+        if (h.key) {
+            key = off;
+        }
+        off = next_record(H, off);
+    }
+
+    memset(out->data, 0, (out->n_rows + 2) * out->stride * sizeof(uint64_t));
+    off = key;
+    history_record h = read_header(H, off);
+    H->replayed = 0;
+    while (true) {
+        apply_record(H, off, out);
+        H->replayed++;
+        *gen = h.generation;
+        *updates = h.updates;
+        if (off == H->last) {
+            break;
+        }
+        off = next_record(H, off);
+        h = read_header(H, off);
+        if (h.key || h.generation > generation) {                   // a keyframe after the first one lies past the generation
+            break;
+        }
+    }
+    uint64_t ns = clock_ns() - t0;
+    H->seeks++;
+    H->seek_ns += ns;
+    if (ns > H->seek_max_ns) {
+        H->seek_max_ns = ns;
+    }
+    return true;
+}
+
+
+bool history_rewind(history* H, game_state* G, long updates) {
+    if (!H->n_records || !updates) {
+        return false;
+    }
+    size_t off = H->head;                                           // the record of the current board, then the target
+    size_t cur = 0;
+    for (size_t r = 0; r < H->n_records; r++) {
+        if (read_header(H, off).generation > G->generation) {
+            break;
+        }
+        cur = r;
+        off = next_record(H, off);
+    }
+    long target = (long)cur + updates;
+    if (target < 0) target = 0;
+    if (target >= (long)H->n_records) target = (long)H->n_records - 1;
+    off = H->head;
+    for (long r = 0; r < target; r++) {
+        off = next_record(H, off);
+    }
+    size_t generation = read_header(H, off).generation;
+    if (generation == G->generation) {
+        return false;                                               // already the oldest or newest board kept
+    }
+    size_t gen, upd;
+    history_seek(H, generation, G->B, &gen, &upd);
+    G->generation = gen;
+    G->updates = upd;
+    G->hash = board_hash(G->B);                                     // the statistics shown while paused
+    if (G->stats) {
+        G->population = board_population(G->B);
+    }
+    for (size_t t = 0; t < G->n_tile_rows * G->n_tile_cols; t++) {
+        G->tile_gen[t] = gen;
+    }
+    G->epoch++;                                                     // the copies kept with tile_gen are refreshed in full
+    return true;
+}
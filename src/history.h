@@ -0,0 +1,128 @@
+/*
+ -------------------------------------
+ File:    history.h
+ Project: conway-game-of-life
+ Header for the memory-bounded history of past generations (pause, rewind and seek)
+ -------------------------------------
+ Author:  Akshath Wikramanayake
+ Email:   akshath.wikramanayake@gmail.com
+ Version  0.0.1
+ -------------------------------------
+ */
+
+#ifndef HISTORY_H
+#define HISTORY_H
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "life_functions.h"
+
+#define HISTORY_KEY_INTERVAL 64     // most deltas replayed by a seek: a keyframe is recorded at least this often
+#define HISTORY_DEFAULT_MB 64       // history budget of the interactive game
+#define HISTORY_SEEKS 16            // boards rebuilt to measure the seek latency of a headless run
+
+
+/*
+    Header of one record of the history. A keyframe is the board diffed against an empty board, a delta the
+    board diffed against the previous record. The payload holds the changed words in board order (word k is
+    word k % n_words of row k / n_words, n_words = (n_cols + 63) / 64): a LEB128 varint of the # of unchanged
+    words skipped since the last changed one, then the XOR of the old and new word (8 bytes, little-endian).
+*/
+typedef struct _history_record {
+    uint64_t generation;        // generation of the board after the record
+    uint64_t updates;           // # of updates at that generation
+    uint64_t count;             // # of changed words in the payload
+    uint64_t size;              // bytes of the record, header included
+    bool key;                   // true: keyframe | false: delta of the previous record
+} history_record;
+
+
+/*
+    Past generations of a game kept in a ring of records of at most budget bytes. game_advance appends the
+    flip list of every update, taken from the tiles that changed in it (see tile_gen); a keyframe starts a new
+    segment every HISTORY_KEY_INTERVAL updates, or sooner once the deltas of the segment outgrow its keyframe.
+    When the ring is full the oldest segment is evicted whole, so the oldest record kept is always a keyframe.
+    Any generation kept is rebuilt by replaying the deltas that follow the keyframe before it.
+    Records never wrap around the end of the ring: a record that does not fit before it starts at offset 0.
+*/
+typedef struct _history {
+    uint8_t* data;              // ring of records
+    size_t size;                // bytes of the ring (the budget)
+    size_t head;                // offset of the oldest record (a keyframe)
+    size_t tail;                // offset at which the next record is written
+    size_t end;                 // end of the records before the wrap (wrapped only)
+    bool wrapped;               // true: the records are [head, end) then [0, tail) | false: [head, tail)
+    size_t n_records;
+    size_t used;                // bytes of the records kept
+
+    size_t last;                // offset of the newest record
+    size_t since_key;           // # of deltas after the newest keyframe
+    uint64_t since_key_bytes;   // bytes of those deltas
+    uint64_t key_bytes;         // bytes of the newest keyframe
+    size_t first_gen;           // oldest generation kept
+    size_t last_gen;            // newest generation kept
+
+    size_t n_words;             // data words per row
+    size_t word_bytes;          // most bytes taken by one changed word (gap varint + XOR)
+    size_t* cols;               // scratch: tile columns of one tile row that changed in the update
+
+    size_t keys;                // # of keyframes recorded
+    size_t deltas;              // # of deltas recorded
+    uint64_t key_total;         // bytes of the keyframes recorded
+    uint64_t delta_total;       // bytes of the deltas recorded
+    size_t evicted;             // # of records evicted to make room
+    size_t seeks;               // # of boards rebuilt
+    uint64_t seek_ns;           // total time spent rebuilding boards
+    uint64_t seek_max_ns;       // slowest rebuild
+    size_t replayed;            // # of records applied by the last seek
+} history;
+
+
+/*
+    Allocates an empty history for the boards of a game (the first record is written by game_start)
+    budget: bytes of the ring
+    returns: pointer to the new history | NULL if the budget cannot hold a keyframe of a full board
+*/
+history* create_history(const game_state* G, size_t budget);
+
+
+/*
+    Deallocates a history
+*/
+void destroy_history(history*);
+
+
+/*
+    Drops the records of G->generation and later and records the current board as a keyframe (see game_start)
+*/
+void history_restart(history*, const game_state* G);
+
+
+/*
+    Records the update just computed by game_update: the words of the tiles stamped with G->generation that
+    differ between G->B and the previous board (G->next). Cost is proportional to the # of changed tiles,
+    plus a scan of the whole board when a keyframe is due.
+*/
+void history_push(history*, const game_state* G);
+
+
+/*
+    Rebuilds the newest board kept at or before a generation by replaying the records from the keyframe before it
+    out: receives the board (same size as the game board, the halo is cleared)
+    gen, updates: receive the generation and # of updates of the board rebuilt
+    returns: false if the generation is older than every board kept (out is untouched)
+*/
+bool history_seek(history*, size_t generation, board* out, size_t* gen, size_t* updates);
+
+
+/*
+    Replaces the board of a paused game with the board kept closest to `updates` updates away from the current
+    one (< 0: back, > 0: forward, clamped to the generations kept). The game goes on from there once game_start
+    is called again, which drops the generations after it.
+    returns: true if the board was replaced
+*/
+bool history_rewind(history*, game_state* G, long updates);
+
+#endif
@@ -11,62 +11,178 @@
  */
 
 #include <stdlib.h>
+#include <stdint.h>
 #include <stdbool.h>
 #include <pthread.h>
 #include <stdatomic.h>
 #include <ncurses/ncurses.h>
 #include <string.h>
+#include <time.h>
 
 #include "life_functions.h"
+#include "worker_pool.h"
+#include "hashlife.h"
+#include "cycle.h"
+#include "sparse.h"
+#include "checkpoint.h"
+#include "perf.h"
+#include "gen_stats.h"
+#include "pacer.h"
+#include "recorder.h"
+#include "history.h"
+
+
+static atomic_size_t n_allocs = 0;                                  // # of allocations made through game_malloc/game_calloc
 
 
 void init_game(game_state* G, size_t rows, size_t cols, size_t maxiters, bool toroidal) {
     G->mtx = PTHREAD_MUTEX_INITIALIZER;
     G->draw_inp = PTHREAD_COND_INITIALIZER;
-    G->draw_upd = PTHREAD_COND_INITIALIZER;
-    G->upd = PTHREAD_COND_INITIALIZER;
 
     G->update_rate = 10;
+    G->updates_per_frame = 1;
     G->n_rows = rows;
     G->n_cols = cols;
     G->maxiters = maxiters;
     G->toroidal = toroidal;
+    G->engine = ENGINE_BITWISE;
+    G->pool = NULL;
+    G->hl = NULL;
+    G->sparse = NULL;
+    G->gens_per_update = 1;
+    G->jump = 0;
+    rule_init(&G->rule, RULE_LIFE_BIRTH, RULE_LIFE_SURVIVE);
+    G->lut = NULL;
+    G->block = NULL;
+    G->block_rows = 0;
 
     G->xpos = 0;
     G->ypos = 0;
     G->last_command = 0;
     G->starty = 0;
+    view_init(&G->view, rows, cols, 1, rows + STATUS_LINES, 2 * cols + 3);    // whole board at 1:1 until the terminal is known
 
     G->spawns = 0;
     G->updates = 0;
-    G->drawn = 0;
+    G->generation = 0;
+    G->renderer = NULL;
+    G->ckpt = NULL;
+    G->rec = NULL;
+    G->perf = NULL;
+    G->stats = NULL;
+    G->population = 0;
+    G->pacer = NULL;
+    G->hist = NULL;
+    G->epoch = 0;
 
     G->inp_over = false;
     G->finished = false;
+    G->paused = false;
+    G->seek = 0;
+    G->edit = false;
+
+    G->B = create_board(rows, cols);                                // board data is initialised to 0s
+    G->next = create_board(rows, cols);                             // both buffers keep their halo for the whole game
 
-    G->Mv = create_matrix(rows, cols);
-    bool** M = G->Mv;                                               // initialise matrix data to 0s
-    memset((void*)M[0], 0, sizeof(bool) * rows * cols);             //  M[0], the first row pointer, points to the start of thecontiguous block of matrix data
+    G->n_tile_rows = (rows + TILE_ROWS - 1) / TILE_ROWS;
+    G->n_tile_cols = (cols + 63) / 64;
+    G->tile_gen = game_calloc(G->n_tile_rows * G->n_tile_cols, sizeof(size_t));
+    G->active = game_calloc(G->n_tile_rows * G->n_tile_cols, sizeof(bool));
+
+    G->hash = 0;
+    G->stop_reason = STOP_NONE;
+    G->cycle = create_cycle_detector(rows, cols, CYCLE_HISTORY);
 }
 
 
 void destroy_game(game_state* G) {
-    bool** ptr = G->Mv;
-    free((void*)ptr[0]);                                            // free matrix data block
-    free(G->Mv);                                                    // free array of row pointers
+    if (G->pool) {
+        destroy_pool(G->pool);
+    }
+    if (G->hl) {
+        destroy_hashlife(G->hl);
+    }
+    if (G->sparse) {
+        destroy_sparse_grid(G->sparse);
+    }
+    destroy_board(G->B);
+    destroy_board(G->next);
+    free(G->tile_gen);
+    free(G->active);
+    free(G->lut);
+    free(G->block);
+    destroy_cycle_detector(G->cycle);
+    if (G->renderer) {
+        destroy_renderer(G->renderer);
+    }
+    if (G->hist) {
+        destroy_history(G->hist);
+    }
+    if (G->ckpt) {
+        destroy_checkpointer(G->ckpt);
+    }
+    free(G->perf);
+    if (G->stats) {
+        destroy_stats_writer(G->stats);
+    }
+    if (G->rec) {
+        destroy_recorder(G->rec);
+    }
+}
+
+
+void* game_malloc(size_t size) {
+    atomic_fetch_add(&n_allocs, 1);
+    return malloc(size);
 }
 
 
-void* create_matrix(size_t rows, size_t cols) {
-    void* RPv = malloc(rows * sizeof(bool*));                       // allocate memory for array of row pointers
-    bool** row_ptrs = (bool**)RPv;
-    row_ptrs[0] = malloc(rows * cols * sizeof(bool));               // allocate memory for matrix data
+void* game_calloc(size_t n, size_t size) {
+    atomic_fetch_add(&n_allocs, 1);
+    return calloc(n, size);
+}
+
+
+size_t game_alloc_count(void) {
+    return atomic_load(&n_allocs);
+}
+
 
-    for (int i = 1; i < rows; i++) {
-        row_ptrs[i] = row_ptrs[0] + i * cols;                       // make row pointers point to start of each row
+board* create_board(size_t rows, size_t cols) {
+    board* B = game_malloc(sizeof(board));
+    B->n_rows = rows;
+    B->n_cols = cols;
+    B->stride = ((cols + 63) / 64) + 2;                             // data words + a halo word on either side
+    B->data = game_calloc((rows + 2) * B->stride, sizeof(uint64_t));    // padded rows are stored contiguously
+    B->map_base = NULL;
+    B->map_size = 0;
+    return B;
+}
+
+
+void destroy_board(board* B) {
+    if (B->map_base) {
+        unmap_board(B);                                             // board restored from a checkpoint
+    } else {
+        free(B->data);
+    }
+    free(B);
+}
+
+
+void board_fill_halo(board* B, bool toroidal) {
+    for (size_t i = 1; i < B->n_rows + 1; i++) {                    // left and right halo cells of each row
+        fill_row_halo(board_row(B, i), B->n_cols, toroidal);
     }
 
-    return RPv;         // return void* to START OF ROW POINTER ARRAY. Start of data block can be accessed using (bool**)RPv[0].
+    size_t bytes = B->stride * sizeof(uint64_t);
+    if (toroidal) {                                                 // top and bottom halo rows including corners
+        memcpy(board_row(B, 0), board_row(B, B->n_rows), bytes);
+        memcpy(board_row(B, B->n_rows + 1), board_row(B, 1), bytes);
+    } else {
+        memset(board_row(B, 0), 0, bytes);
+        memset(board_row(B, B->n_rows + 1), 0, bytes);
+    }
 }
 
 
@@ -110,65 +226,764 @@ void create_box(WIN * p_win, bool flag) {
 }
 
 
-int game_update(game_state* G) {
-    size_t count;                                                   // stores # of tiles whose life/death status has changed
+/*
+    Life status of the cell in padded row `row` at padded column pj (0 and n_cols + 1 are halo columns)
+*/
+static inline
+bool padded_cell(const uint64_t* row, size_t pj) {
+    return (row[(pj + 63) >> 6] >> ((pj + 63) & 63)) & 1;
+}
+
+
+/*
+    Naive update: counts the living neighbours of each tile one at a time
+    rule: birth/survival rule
+    old: board before the update (halo filled in)
+    B: board that receives the updated values (every tile in rows [r0, r1) is overwritten)
+    r0, r1: range of board rows to update
+*/
+static
+step_result update_naive(const life_rule* rule, const board* old, board* B, size_t r0, size_t r1) {
+    step_result res = step_init();
+    size_t count = 0;                                               // stores # of tiles whose life/death status has changed
+    uint64_t last_mask = last_word_mask(B);
+
+    // temporary var to store number of neighbours
+    size_t nbrs = 0;
+
+    // fill in B with updated values
+    for (size_t i = r0 + 1; i < r1 + 1; i++) {
+        const uint64_t* up = board_row(old, i - 1);
+        const uint64_t* mid = board_row(old, i);
+        const uint64_t* dn = board_row(old, i + 1);
+        for (size_t j = 1; j < B->n_cols + 1; j++) {
+            nbrs = padded_cell(up, j-1) + padded_cell(up, j) + padded_cell(up, j+1) + padded_cell(mid, j-1) + padded_cell(mid, j+1) + padded_cell(dn, j-1) + padded_cell(dn, j) + padded_cell(dn, j+1);
+            bool current = padded_cell(mid, j);
+            bool temp = test_life(rule, current, nbrs);             // check if tile in the old board will have life next cycle
+            count += (temp != current);                             // if life/death status next cycle is different, increment count
+            res.births += (temp && !current);
+            set_cell(B, i-1, j-1, temp);                            // set new life/death status to the corresponding tile in the board
+        }
+        const uint64_t* out = board_row(B, i);
+        for (size_t w = 1; w < B->stride - 1; w++) {                // update the board hash for the changed words
+            uint64_t mask = (w == B->stride - 2) ? last_mask : ~(uint64_t)0;
+            res.hash ^= word_hash(i * B->stride + w, mid[w] & mask) ^ word_hash(i * B->stride + w, out[w] & mask);
+            step_bounds(&res, i - 1, w - 1, out[w] & mask);
+        }
+    }
+    res.changed = count;
+    return res;
+}
 
-    bool** tempgrid =  create_matrix(G->n_rows+2, G->n_cols+2);     // create placeholder matrix to hold old board + padding
-    bool** M = G->Mv;
 
-    // set the corners/edges to padding values
-    if (G->toroidal) {                                              // toroidal: copy values from opposite point on the board
-        // horizontal edges minus corners
-        memcpy(tempgrid[0] + 1, M[G->n_rows - 1], G->n_cols * sizeof(bool));
-        memcpy(tempgrid[G->n_rows + 1] + 1, M[0], G->n_cols * sizeof(bool));
+/*
+    Bitwise update: computes 64 tiles at a time from the bit-packed rows of G->B into G->next.
+    Only active tiles are computed: a tile whose 3x3 neighbourhood of tiles did not change in the last
+    update cannot change either, and the back buffer already holds its contents (it was unchanged between
+    the generation in the back buffer and the current one).
+    r0, r1: range of board rows to update (r0 must be a multiple of TILE_ROWS so bands own whole tiles)
+    life: true: B3/S23 kernel (life_word) | false: table kernel for G->rule (rule_word). Always a constant, so
+    each caller gets its own copy of the loop with the kernel inlined and no per-word branch.
+    bounds: true: also track the bounding box of the living tiles (quiet words are read but not computed).
+    Also a constant.
+*/
+static inline __attribute__((always_inline))
+step_result update_bitwise_with(game_state* G, size_t r0, size_t r1, bool life, bool bounds) {
+    const board* old = G->B;
+    board* B = G->next;
+    step_result res = step_init();
+    size_t count = 0;
+    size_t births = 0;
+    uint64_t hash = 0;
+    size_t n_words = G->n_tile_cols;                                // data words per row
+    uint64_t last_mask = last_word_mask(B);
+    size_t gen = G->generation + 1;                                 // generation being computed
 
-        // verical edges minus corners
-        for (int i = 1; i < G->n_rows + 1; i++) {
-            tempgrid[i][0] = M[i - 1][G->n_cols - 1];
-            tempgrid[i][G->n_cols + 1] = M[i - 1][0];
+    for (size_t i = r0 + 1; i < r1 + 1; i++) {
+        const uint64_t* up = board_row(old, i - 1);
+        const uint64_t* mid = board_row(old, i);
+        const uint64_t* dn = board_row(old, i + 1);
+        uint64_t* out = board_row(B, i);
+        const bool* active = G->active + ((i - 1) / TILE_ROWS) * n_words;
+        size_t* tile_gen = G->tile_gen + ((i - 1) / TILE_ROWS) * n_words;
+        for (size_t w = 1; w < n_words + 1; w++) {
+            uint64_t mask = (w == n_words) ? last_mask : ~(uint64_t)0;     // tiles past the last column stay dead
+            if (!active[w - 1]) {
+                if (bounds) {
+                    step_bounds(&res, i - 1, w - 1, mid[w] & mask);    // unchanged: the next generation is the same word
+                }
+                continue;                                           // quiet region: skip
+            }
+            uint64_t next = (life ? life_word(up, mid, dn, w) : rule_word(&G->rule, up, mid, dn, w)) & mask;
+            uint64_t diff = next ^ (mid[w] & mask);
+            if (diff) {
+                count += __builtin_popcountll(diff);                // # of tiles whose status changed
+                births += __builtin_popcountll(diff & next);
+                hash ^= word_hash(i * B->stride + w, mid[w] & mask) ^ word_hash(i * B->stride + w, next);
+                tile_gen[w - 1] = gen;
+            }
+            if (bounds) {
+                step_bounds(&res, i - 1, w - 1, next);
+            }
+            out[w] = next;
         }
+    }
+    res.changed = count;
+    res.births = births;
+    res.hash = hash;
+    return res;
+}
+
+
+/*
+    Bitwise update with the kernel selected for G->rule (Life runs the hardcoded B3/S23 loop) and the bounding
+    box only tracked when statistics are logged
+*/
+static
+step_result update_bitwise(game_state* G, size_t r0, size_t r1) {
+    if (G->rule.kernel == KERNEL_LIFE) {
+        return G->stats ? update_bitwise_with(G, r0, r1, true, true) : update_bitwise_with(G, r0, r1, true, false);
+    }
+    return G->stats ? update_bitwise_with(G, r0, r1, false, true) : update_bitwise_with(G, r0, r1, false, false);
+}
 
-        // corners
-        tempgrid[0][0] = M[G->n_rows - 1][G->n_cols - 1];
-        tempgrid[G->n_rows + 1][0] = M[0][G->n_cols - 1];
-        tempgrid[0][G->n_cols + 1] = M[G->n_rows - 1][0];
-        tempgrid[G->n_rows + 1][G->n_cols + 1] = M[0][0];
 
-    } else {                                                        // not toroidal => walls are padded with 0s
-        for (int i = 0; i < G->n_rows + 2; i++) {
-            tempgrid[i][0] = false;                                 // padding left and right columns including corners
-            tempgrid[i][G->n_cols + 1] = false;
+/*
+    Temporal blocking: advances rows [r0, r1) of G->B by T = G->gens_per_update generations into G->next, one
+    sub-band of G->block_rows rows at a time. A sub-band is copied with T halo rows above and below (wrapped
+    around on toroidal boards) into scratch buffers that stay in cache and stepped T times there: the rows
+    that are still exact shrink by one on each side per generation, so after T generations the sub-band's own
+    rows are. The board is read and written once per T generations instead of once per generation, for
+    2 T / block_rows redundant rows. Every word is computed: a tile can change and change back within an update,
+    so active tiles do not apply.
+    band: index of the caller's band, selects its scratch buffers
+    life: true: B3/S23 kernel | false: table kernel for G->rule (a constant, see update_bitwise_with)
+*/
+static inline __attribute__((always_inline))
+step_result update_temporal_with(game_state* G, size_t r0, size_t r1, size_t band, bool life) {
+    const board* old = G->B;
+    board* B = G->next;
+    size_t T = G->gens_per_update;
+    size_t H = G->block_rows;
+    size_t stride = B->stride;
+    size_t n_words = G->n_tile_cols;
+    long n_rows = B->n_rows;
+    uint64_t last_mask = last_word_mask(B);
+    size_t gen = G->generation + T;                                 // generation being computed
+    uint64_t* buf[2];
+    buf[0] = G->block + band * 2 * (H + 2 * T) * stride;
+    buf[1] = buf[0] + (H + 2 * T) * stride;
+    step_result res = step_init();
+
+    for (size_t b0 = r0; b0 < r1; b0 += H) {
+        size_t b1 = (b0 + H < r1) ? b0 + H : r1;
+        size_t n = (b1 - b0) + 2 * T;                               // scratch row k holds board row b0 - T + k
+        for (size_t k = 0; k < n; k++) {
+            long row = (long)b0 - (long)T + (long)k;
+            if (G->toroidal) {
+                row = ((row % n_rows) + n_rows) % n_rows;
+            }
+            if (row >= 0 && row < n_rows) {
+                memcpy(buf[0] + k * stride, board_row(old, row + 1), stride * sizeof(uint64_t));   // halo cells included
+            } else {                                                // beyond the walls: dead for every generation
+                memset(buf[0] + k * stride, 0, stride * sizeof(uint64_t));
+                memset(buf[1] + k * stride, 0, stride * sizeof(uint64_t));
+            }
         }
-        for (int j = 1; j < G->n_cols + 1; j++) {                   // padding top and bottom row, excluding corners (doesn't matter if you overwrite corners)
-            tempgrid[0][j] = false;
-            tempgrid[G->n_rows + 1][j] = false;
+
+        uint64_t* cur = buf[0];
+        uint64_t* nxt = buf[1];
+        for (size_t s = 1; s <= T; s++) {
+            bool final = (s == T);
+            for (size_t k = s; k < n - s; k++) {                    // rows that are still exact after s generations
+                long row = (long)b0 - (long)T + (long)k;
+                if (!G->toroidal && (row < 0 || row >= n_rows)) {
+                    continue;
+                }
+                const uint64_t* up = cur + (k - 1) * stride;
+                const uint64_t* mid = cur + k * stride;
+                const uint64_t* dn = cur + (k + 1) * stride;
+                uint64_t* out = nxt + k * stride;
+                for (size_t w = 1; w < n_words + 1; w++) {
+                    uint64_t mask = (w == n_words) ? last_mask : ~(uint64_t)0;
+                    out[w] = (life ? life_word(up, mid, dn, w) : rule_word(&G->rule, up, mid, dn, w)) & mask;
+                    if (final) {
+                        res.last += __builtin_popcountll(out[w] ^ (mid[w] & mask));
+                    }
+                }
+                fill_row_halo(out, B->n_cols, G->toroidal);
+            }
+            uint64_t* tmp = cur;
+            cur = nxt;
+            nxt = tmp;
+        }
+
+        for (size_t i = b0 + 1; i < b1 + 1; i++) {                  // compare with the start of the update and write back
+            const uint64_t* start = board_row(old, i);
+            const uint64_t* now = cur + (i - 1 - b0 + T) * stride;
+            uint64_t* out = board_row(B, i);
+            size_t* tile_gen = G->tile_gen + ((i - 1) / TILE_ROWS) * n_words;
+            for (size_t w = 1; w < n_words + 1; w++) {
+                uint64_t mask = (w == n_words) ? last_mask : ~(uint64_t)0;    // the right halo cell may share the last word
+                uint64_t next = now[w] & mask;
+                uint64_t diff = next ^ (start[w] & mask);
+                if (diff) {
+                    res.changed += __builtin_popcountll(diff);
+                    res.births += __builtin_popcountll(diff & next);
+                    res.hash ^= word_hash(i * stride + w, start[w] & mask) ^ word_hash(i * stride + w, next);
+                    tile_gen[w - 1] = gen;
+                }
+                if (G->stats) {
+                    step_bounds(&res, i - 1, w - 1, next);
+                }
+                out[w] = next;
+            }
         }
     }
+    return res;
+}
+
 
-    // copy old board to interior of placeholder matrix
-    for (int i = 0; i < G->n_rows; i++) {                                   // tempgrid[0][j] is the top row used for padding -> avoid! (same for bottom row)
-        memcpy(&tempgrid[i+1][1], M[i], G->n_cols * sizeof(bool));          // tempgrid[i][0] is the left column, also for padding -> avoid! (same for right column)
+/*
+    Temporal blocking with the kernel selected for G->rule
+*/
+static
+step_result update_temporal(game_state* G, size_t r0, size_t r1, size_t band) {
+    if (G->rule.kernel == KERNEL_LIFE) {
+        return update_temporal_with(G, r0, r1, band, true);
     }
+    return update_temporal_with(G, r0, r1, band, false);
+}
 
-    // Reset Lv->M to an empty board after copying
-    memset(M[0], 0, G->n_rows * G->n_cols * sizeof(bool));
 
-    // temporary var to store number of neighbours
-    size_t nbrs = 0;
+/*
+    Fills in the block table for a rule. Bit 4 * y + x of an index is the cell at row y, column x of a 4 x 4
+    neighbourhood; bit 2 * y + x of the entry is the next state of centre cell (y + 1, x + 1).
+*/
+static
+void build_block_lut(uint8_t* lut, const life_rule* rule) {
+    for (size_t idx = 0; idx < LUT_SIZE; idx++) {
+        uint8_t res = 0;
+        for (size_t y = 1; y < 3; y++) {
+            for (size_t x = 1; x < 3; x++) {
+                size_t nbrs = 0;
+                for (size_t dy = y - 1; dy < y + 2; dy++) {
+                    for (size_t dx = x - 1; dx < x + 2; dx++) {
+                        nbrs += (dy != y || dx != x) && ((idx >> (4 * dy + dx)) & 1);
+                    }
+                }
+                bool current = (idx >> (4 * y + x)) & 1;
+                res |= test_life(rule, current, nbrs) << (2 * (y - 1) + (x - 1));
+            }
+        }
+        lut[idx] = res;
+    }
+}
+
+
+/*
+    Padded row window of data word w: bit k is the cell at column 64 * (w - 1) + k - 1, so the 4 columns
+    around cells k and k + 1 are bits k..k + 3
+*/
+static inline
+unsigned __int128 row_window(const uint64_t* row, size_t w) {
+    return (row[w - 1] >> 63) | ((unsigned __int128)row[w] << 1) | ((unsigned __int128)row[w + 1] << 65);
+}
+
+
+/*
+    Block table update: computes the board two rows and two columns at a time, looking up each 2 x 2 block
+    from the 16 cells around it in G->lut (64 KiB, stays in L2). Every tile is computed (no active tiles).
+    r0, r1: range of board rows to update (r0 must be even so that bands own whole blocks)
+*/
+static
+step_result update_lut(const game_state* G, size_t r0, size_t r1) {
+    const board* old = G->B;
+    board* B = G->next;
+    const uint8_t* lut = G->lut;
+    step_result res = step_init();
+    size_t n_words = G->n_tile_cols;
+    uint64_t last_mask = last_word_mask(B);
+
+    for (size_t i = r0 + 1; i < r1 + 1; i += 2) {                   // padded rows i and i + 1
+        bool pair = (i + 1 < r1 + 1);                               // false: single last row, i + 1 is the halo
+        const uint64_t* rows[4] = { board_row(old, i - 1), board_row(old, i), board_row(old, i + 1),
+                                    board_row(old, pair ? i + 2 : i + 1) };    // only read for the discarded 2nd row
+        uint64_t* out[2] = { board_row(B, i), board_row(B, pair ? i + 1 : i) };
+        for (size_t w = 1; w < n_words + 1; w++) {
+            unsigned __int128 win[4];
+            for (int k = 0; k < 4; k++) {
+                win[k] = row_window(rows[k], w);
+            }
+            uint64_t next[2] = { 0, 0 };
+            if (win[0] | win[1] | win[2] | win[3]) {                // an empty neighbourhood stays empty (no B0)
+                for (int b = 0; b < 64; b += 2) {
+                    size_t idx = ((size_t)(win[0] >> b) & 0xF) | (((size_t)(win[1] >> b) & 0xF) << 4)
+                               | (((size_t)(win[2] >> b) & 0xF) << 8) | (((size_t)(win[3] >> b) & 0xF) << 12);
+                    uint64_t res = lut[idx];
+                    next[0] |= (res & 3) << b;
+                    next[1] |= (res >> 2) << b;
+                }
+            }
+            uint64_t mask = (w == n_words) ? last_mask : ~(uint64_t)0;     // tiles past the last column stay dead
+            for (int k = 0; k < (pair ? 2 : 1); k++) {
+                uint64_t cur = rows[k + 1][w] & mask;
+                next[k] &= mask;
+                if (next[k] != cur) {
+                    res.changed += __builtin_popcountll(next[k] ^ cur);
+                    res.births += __builtin_popcountll(next[k] & ~cur);
+                    res.hash ^= word_hash((i + k) * B->stride + w, cur) ^ word_hash((i + k) * B->stride + w, next[k]);
+                }
+                step_bounds(&res, i + k - 1, w - 1, next[k]);
+                out[k][w] = next[k];
+            }
+        }
+    }
+    return res;
+}
+
+
+/*
+    Marks the tiles that changed in the last update and their neighbours (wrapping around on toroidal boards)
+    as active for the current update
+*/
+static
+void mark_active_tiles(game_state* G) {
+    size_t tr = G->n_tile_rows;
+    size_t tc = G->n_tile_cols;
+    memset(G->active, 0, tr * tc * sizeof(bool));
+    for (size_t y = 0; y < tr; y++) {
+        for (size_t x = 0; x < tc; x++) {
+            if (G->tile_gen[y * tc + x] != G->generation) {
+                continue;
+            }
+            for (long dy = -1; dy <= 1; dy++) {
+                for (long dx = -1; dx <= 1; dx++) {
+                    long ny = (long)y + dy;
+                    long nx = (long)x + dx;
+                    if (G->toroidal) {
+                        ny = (ny + (long)tr) % (long)tr;
+                        nx = (nx + (long)tc) % (long)tc;
+                    } else if (ny < 0 || nx < 0 || ny >= (long)tr || nx >= (long)tc) {
+                        continue;
+                    }
+                    G->active[ny * tc + nx] = true;
+                }
+            }
+        }
+    }
+}
+
+
+step_result update_rows(game_state* G, size_t r0, size_t r1, size_t band) {
+    if (G->engine == ENGINE_NAIVE) {
+        return update_naive(&G->rule, G->B, G->next, r0, r1);
+    }
+    if (G->engine == ENGINE_LUT) {
+        return update_lut(G, r0, r1);
+    }
+    if (G->gens_per_update > 1) {
+        return update_temporal(G, r0, r1, band);
+    }
+    return update_bitwise(G, r0, r1);
+}
+
+
+/*
+    # of tiles whose life/death status differs between two boards of the same size
+*/
+static
+size_t board_diff_count(const board* A, const board* B) {
+    size_t count = 0;
+    uint64_t last_mask = last_word_mask(A);
+    for (size_t i = 1; i < A->n_rows + 1; i++) {
+        const uint64_t* a = board_row(A, i);
+        const uint64_t* b = board_row(B, i);
+        for (size_t w = 1; w < A->stride - 1; w++) {
+            uint64_t mask = (w == A->stride - 2) ? last_mask : ~(uint64_t)0;
+            count += __builtin_popcountll((a[w] ^ b[w]) & mask);
+        }
+    }
+    return count;
+}
+
+
+size_t board_population(const board* B) {
+    size_t pop = 0;
+    uint64_t last_mask = last_word_mask(B);
+    for (size_t i = 1; i < B->n_rows + 1; i++) {
+        const uint64_t* row = board_row(B, i);
+        for (size_t w = 1; w < B->stride - 1; w++) {
+            uint64_t mask = (w == B->stride - 2) ? last_mask : ~(uint64_t)0;
+            pop += __builtin_popcountll(row[w] & mask);
+        }
+    }
+    return pop;
+}
+
 
-    // fill in M with updated values
+/*
+    splitmix64 PRNG step
+*/
+static inline
+uint64_t splitmix64(uint64_t* state) {
+    uint64_t x = (*state += 0x9E3779B97F4A7C15ull);
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+    return x ^ (x >> 31);
+}
+
+
+void random_row(uint64_t* row, size_t n_cols, double density, uint64_t* state) {
+    uint64_t threshold = (density >= 1.0) ? UINT64_MAX : (uint64_t)(density * 18446744073709551616.0);
+    uint64_t last_mask = (n_cols & 63) ? ((uint64_t)1 << (n_cols & 63)) - 1 : ~(uint64_t)0;
+    size_t n_words = (n_cols + 63) / 64;
+    for (size_t w = 1; w < n_words + 1; w++) {
+        uint64_t word = 0;
+        for (int b = 0; b < 64; b++) {
+            word |= (uint64_t)(splitmix64(state) < threshold) << b;
+        }
+        row[w] = (w == n_words) ? (word & last_mask) : word;
+    }
+}
+
+
+void board_randomise(board* B, double density, uint64_t seed) {
+    uint64_t state = seed;
+    memset(B->data, 0, (B->n_rows + 2) * B->stride * sizeof(uint64_t));
+    for (size_t i = 1; i < B->n_rows + 1; i++) {
+        random_row(board_row(B, i), B->n_cols, density, &state);
+    }
+}
+
+
+bool board_equal(const board* A, const board* B) {
+    return board_diff_count(A, B) == 0;
+}
+
+
+void board_copy(board* dst, const board* src) {
+    memcpy(dst->data, src->data, (src->n_rows + 2) * src->stride * sizeof(uint64_t));
+}
+
+
+void board_copy_changed(board* dst, const game_state* G, size_t since, size_t epoch) {
+    if (epoch != G->epoch) {                                        // rewound or edited: tile_gen says nothing about the copy
+        board_copy(dst, G->B);
+        return;
+    }
+    size_t tc = G->n_tile_cols;
+    for (size_t t = 0; t < G->n_tile_rows * tc; t++) {
+        if (G->tile_gen[t] <= since) {
+            continue;
+        }
+        size_t r1 = (t / tc + 1) * TILE_ROWS;
+        if (r1 > G->n_rows) r1 = G->n_rows;
+        for (size_t i = (t / tc) * TILE_ROWS + 1; i < r1 + 1; i++) {
+            board_row(dst, i)[t % tc + 1] = board_row(G->B, i)[t % tc + 1];
+        }
+    }
+}
+
+
+uint64_t board_hash(const board* B) {
+    uint64_t hash = 0;
+    uint64_t last_mask = last_word_mask(B);
+    for (size_t i = 1; i < B->n_rows + 1; i++) {
+        const uint64_t* row = board_row(B, i);
+        for (size_t w = 1; w < B->stride - 1; w++) {
+            uint64_t mask = (w == B->stride - 2) ? last_mask : ~(uint64_t)0;
+            hash ^= word_hash(i * B->stride + w, row[w] & mask);
+        }
+    }
+    return hash;
+}
+
+
+/*
+    Births and bounding box of the window of an unbounded engine, from the old and new boards (the engines
+    step the whole universe, so the window needs its own pass)
+*/
+static
+step_result window_stats(const board* old, const board* B) {
+    step_result res = step_init();
+    uint64_t last_mask = last_word_mask(B);
+    for (size_t i = 1; i < B->n_rows + 1; i++) {
+        const uint64_t* a = board_row(old, i);
+        const uint64_t* b = board_row(B, i);
+        for (size_t w = 1; w < B->stride - 1; w++) {
+            uint64_t mask = (w == B->stride - 2) ? last_mask : ~(uint64_t)0;
+            uint64_t diff = (a[w] ^ b[w]) & mask;
+            res.changed += __builtin_popcountll(diff);
+            res.births += __builtin_popcountll(diff & b[w]);
+            step_bounds(&res, i - 1, w - 1, b[w] & mask);
+        }
+    }
+    return res;
+}
+
+
+/*
+    Hands the statistics of the generation just computed to the statistics writer
+    res: result of the update (births and bounding box of the board)
+*/
+static
+void log_stats(game_state* G, const step_result* res) {
+    size_t deaths = res->changed - res->births;
+    G->population += res->births - deaths;
+    bool empty = res->top > res->bottom;
+    gen_stats s = {
+        .generation = G->generation, .population = G->population, .births = res->births, .deaths = deaths,
+        .top = empty ? -1 : (int64_t)res->top, .left = empty ? -1 : (int64_t)res->left,
+        .bottom = empty ? -1 : (int64_t)res->bottom, .right = empty ? -1 : (int64_t)res->right,
+    };
+    stats_push(G->stats, &s);
+}
+
+
+/*
+    Sets tile_gen for the tiles that differ between the new board B and the old board next (the bitwise
+    engine keeps tile_gen up to date itself)
+*/
+static
+void stamp_changed_tiles(game_state* G) {
+    size_t tc = G->n_tile_cols;
     for (size_t i = 1; i < G->n_rows + 1; i++) {
-        for (size_t j = 1; j < G->n_cols + 1; j++) {
-            nbrs = 0;
-            nbrs = tempgrid[i-1][j-1] + tempgrid[i-1][j] + tempgrid[i-1][j+1] + tempgrid[i][j-1] + tempgrid[i][j+1] + tempgrid[i+1][j-1] + tempgrid[i+1][j] + tempgrid[i+1][j+1];
-            bool temp = test_life(tempgrid[i][j], nbrs);            // check if tile in the placehoolder matrix will have life next cycle
-            count += (temp != tempgrid[i][j]);                      // if life/death status next cycle is different, increment count
-            M[i-1][j-1] = temp;                                     // set new life/death status to the corresponding tile in the original matrix
+        const uint64_t* a = board_row(G->B, i);
+        const uint64_t* b = board_row(G->next, i);
+        size_t* tile_gen = G->tile_gen + ((i - 1) / TILE_ROWS) * tc;
+        for (size_t w = 1; w < tc + 1; w++) {
+            if (a[w] != b[w]) {
+                tile_gen[w - 1] = G->generation;
+            }
+        }
+    }
+}
+
+
+/*
+    # of generations one update advances the board (see gens_per_update)
+*/
+static inline
+size_t gens_per_step(const game_state* G) {
+    return (G->engine == ENGINE_HASHLIFE || G->engine == ENGINE_BITWISE) ? G->gens_per_update : 1;
+}
+
+
+bool game_start(game_state* G) {
+    if (G->engine == ENGINE_HASHLIFE) {
+        if (!hashlife_load(G->hl, G->B)) {
+            return false;
+        }
+        if (G->jump) {                                              // -j: skip ahead in a few macro-steps, then show the window
+            if (!hashlife_seek(G->hl, G->jump)) {
+                return false;
+            }
+            hashlife_extract(G->hl, G->B);
+            G->generation += G->jump;
+            G->jump = 0;
+        }
+    }
+    for (size_t t = 0; t < G->n_tile_rows * G->n_tile_cols; t++) {
+        G->tile_gen[t] = G->generation;                             // the board was edited: every tile counts as changed
+    }
+    G->hash = board_hash(G->B);
+    if (G->stats) {
+        G->population = board_population(G->B);                     // kept up to date from the births and deaths
+    }
+    if (G->engine == ENGINE_SPARSE) {                               // the board is the window at the origin of the universe
+        sparse_load(G->sparse, G->B, 0, 0);
+        G->hash = G->sparse->hash;
+    }
+    if (G->engine == ENGINE_HASHLIFE) {                             // cycles are found from the hash of the whole universe
+        G->hash = hashlife_hash(G->hl);
+    }
+    G->stop_reason = STOP_NONE;
+    if (G->updates * gens_per_step(G) >= G->maxiters) {
+        G->stop_reason = STOP_MAXITERS;                             // e.g. resumed from a checkpoint that already reached it
+    }
+    cycle_reset(G->cycle);
+    cycle_check(G->cycle, G->B, G->hash, G->generation);            // the starting board is the first entry of the history
+    if (G->engine == ENGINE_LUT && !G->lut) {                       // the rule is final: compile it into the table once
+        G->lut = game_malloc(LUT_SIZE);                             // (a reused game, e.g. a soup search worker, keeps it)
+        build_block_lut(G->lut, &G->rule);
+    }
+    if (G->engine == ENGINE_BITWISE && G->gens_per_update > 1 && !G->block) {
+        size_t T = G->gens_per_update;                              // sub-bands fill BLOCK_BYTES, but at least 2 T rows
+        size_t fit = BLOCK_BYTES / (2 * G->B->stride * sizeof(uint64_t));
+        G->block_rows = (fit > 4 * T) ? fit - 2 * T : 2 * T;
+        size_t bands = G->pool ? G->pool->n_workers : 1;
+        G->block = game_malloc(bands * 2 * (G->block_rows + 2 * T) * G->B->stride * sizeof(uint64_t));
+    }
+    if (G->hist) {
+        history_restart(G->hist, G);                                // the generations after this board are no longer its future
+    }
+    return true;
+}
+
+
+int game_update(game_state* G) {
+    step_result res;                                                // # of tiles whose life/death status has changed + hash update
+
+    board_fill_halo(G->B, G->toroidal);                             // only the halo cells are refreshed, the board is read in place
+
+    step_result window;                                             // births and bounds of the window (unbounded engines)
+    if (G->engine == ENGINE_HASHLIFE) {                             // advance the universe, then copy the window onto the board
+        if (!hashlife_advance(G->hl, G->gens_per_update)) {
+            return -1;
+        }
+        hashlife_extract(G->hl, G->next);
+        res = window = window_stats(G->B, G->next);
+        res.hash = G->hash ^ hashlife_hash(G->hl);                  // the window alone would make false cycles
+        if (res.changed == 0 && res.hash != 0) {
+            res.changed = 1;                                        // not steady: the universe changed outside the window
+        }
+    } else if (G->engine == ENGINE_SPARSE) {                        // step the whole universe, then copy the window
+        res = sparse_step(G->sparse);
+        sparse_extract(G->sparse, G->next, 0, 0);
+        if (G->stats) {
+            window = window_stats(G->B, G->next);
+        }
+    } else {
+        if (G->engine == ENGINE_BITWISE && G->gens_per_update == 1) {
+            mark_active_tiles(G);                                   // quiet tiles are skipped by update_bitwise
+        }
+        if (G->pool) {
+            res = pool_update(G->pool, G);                          // row bands are updated in parallel, results are reduced
+        } else {
+            res = update_rows(G, 0, G->n_rows, 0);
+        }
+    }
+    bool blocked = (G->engine == ENGINE_BITWISE && G->gens_per_update > 1);    // temporal blocking
+
+    board* tmp = G->B;                                              // the back buffer now holds the current generation
+    G->B = G->next;
+    G->next = tmp;
+    G->hash ^= res.hash;
+    G->generation += (G->engine == ENGINE_HASHLIFE || blocked) ? G->gens_per_update : 1;
+    if (G->engine != ENGINE_BITWISE) {
+        stamp_changed_tiles(G);
+    }
+    if (G->stats) {                                                 // gathered while stepping, except for the window
+        log_stats(G, (G->engine == ENGINE_HASHLIFE || G->engine == ENGINE_SPARSE) ? &window : &res);
+    }
+    if (blocked) {                                                  // steady only if the last generation changed nothing
+        return res.last;                                            // (a tile can change and change back within an update)
+    }
+    return res.changed;                                             // if no tiles have changed, early stopping will be triggered
+}
+
+
+/*
+    Returns the true period of a cycle seen one board per update: with gens_per_update T the detector sees the
+    smallest multiple of T that is a multiple of the period (d). The period divides it, so the divisors are tried
+    in increasing order by stepping one generation at a time from the current board (the universe itself for
+    Hashlife, which is left at the same cells a period later). The bounded engines step in G->next and the
+    snapshot of the detector, which are free once the game has stopped.
+*/
+static
+size_t true_period(game_state* G, size_t d) {
+    board* a = G->next;
+    board* b = G->cycle->snapshot;
+    if (G->engine != ENGINE_HASHLIFE) {
+        board_copy(a, G->B);
+    }
+    size_t gen = 0;
+    for (size_t p = 1; p < d; p++) {
+        if (d % p) {
+            continue;
+        }
+        if (G->engine == ENGINE_HASHLIFE) {
+            if (!hashlife_advance(G->hl, p - gen)) {
+                return d;                                           // out of memory: keep the period seen
+            }
+            gen = p;
+            if (hashlife_hash(G->hl) == G->hash) {
+                return p;
+            }
+            continue;
+        }
+        for (; gen < p; gen++) {                                    // one generation of the rule on the whole board
+            board_fill_halo(a, G->toroidal);
+            uint64_t mask = last_word_mask(a);
+            for (size_t i = 1; i < a->n_rows + 1; i++) {
+                const uint64_t* up = board_row(a, i - 1);
+                const uint64_t* mid = board_row(a, i);
+                const uint64_t* dn = board_row(a, i + 1);
+                uint64_t* out = board_row(b, i);
+                for (size_t w = 1; w < a->stride - 1; w++) {
+                    out[w] = rule_word(&G->rule, up, mid, dn, w) & ((w == a->stride - 2) ? mask : ~(uint64_t)0);
+                }
+            }
+            board* tmp = a;
+            a = b;
+            b = tmp;
+        }
+        if (board_equal(a, G->B)) {
+            return p;
         }
     }
-    free((void*)tempgrid[0]);                                       // free the placeholder matrix
-    free((void*)tempgrid);
-    return count;                                                   // if no tiles have changed, early stopping will be triggered
+    return d;
+}
+
+
+bool game_advance(game_state* G) {
+    uint64_t t0 = G->perf ? clock_ns() : 0;
+    size_t gen = G->generation;
+    int res = game_update(G);
+    if (G->perf) {
+        perf_add(&G->perf->update_ns, clock_ns() - t0);
+        perf_count(&G->perf->updates, 1);
+        perf_count(&G->perf->generations, G->generation - gen);
+    }
+    G->updates++;
+    size_t gens = gens_per_step(G);
+    if (res >= 0 && G->hist) {
+        history_push(G->hist, G);                                   // flip list of the tiles that changed in this update
+    }
+    size_t period;
+    if (res < 0) {
+        G->stop_reason = STOP_FAILED;
+    } else if (res == 0 && G->engine == ENGINE_HASHLIFE && gens > 1 && (period = true_period(G, gens)) > 1) {
+        G->stop_reason = STOP_CYCLE;                                // back after gens generations, but not still
+        G->cycle->period = period;
+        G->cycle->start = G->generation - gens;
+        G->cycle->start_min = (G->updates > 1) ? G->cycle->start - gens + 1 : G->cycle->start;
+    } else if (res == 0) {
+        G->stop_reason = STOP_STEADY;
+    } else if (cycle_check(G->cycle, G->B, G->hash, G->generation)) {
+        G->stop_reason = STOP_CYCLE;
+        if (gens > 1) {
+            G->cycle->period = true_period(G, G->cycle->period);
+        }
+    } else if (G->updates * gens >= G->maxiters) {                  // maxiters counts generations, not updates
+        G->stop_reason = STOP_MAXITERS;
+    }
+    if (G->ckpt && G->updates % G->ckpt->interval == 0) {
+        checkpoint_save(G->ckpt, G, false);                         // never waits: skipped if the last one is still being written
+    }
+    if (G->rec && G->updates % G->rec->every == 0) {
+        record_frame(G->rec, G, G->rec->block);                     // only waits for the encoder under the block policy
+    }
+    return G->stop_reason == STOP_NONE;
+}
+
+
+const char* stop_reason_name(size_t reason) {
+    switch (reason) {
+        case STOP_MAXITERS: return "max iterations reached";
+        case STOP_STEADY: return "steady state";
+        case STOP_CYCLE: return "cycle";
+        case STOP_FAILED: return "engine failure";
+        default: return "running";
+    }
+}
+
+
+uint64_t clock_ns(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000ull + now.tv_nsec;
 }
 
 
@@ -181,21 +996,310 @@ int timed_cond_wait(pthread_cond_t* cnd, pthread_mutex_t* mtx) {
 
 
 void draw_board(game_state* G) {
-    bool** M = G->Mv;
-    
-    for (size_t i = 0; i < G->n_rows; i ++) {
-        for (size_t j = 0; j < G->n_cols; j ++) {
-            if (M[i][j]) {
-                mvaddch(i + G->starty, (j * 2) + 2, 'O');
-            } else {
-                mvaddch(i + G->starty, (j * 2) + 2, ' ');
+    draw_view(G->B, &G->view, G->starty, NULL);
+}
+
+
+/*
+    Smallest zoom at which the whole board fits in the view
+*/
+static
+size_t fit_zoom(const viewport* V) {
+    size_t zy = (V->n_rows + V->max_rows - 1) / V->max_rows;
+    size_t zx = (V->n_cols + V->max_cols - 1) / V->max_cols;
+    size_t z = (zy > zx) ? zy : zx;
+    return z ? z : 1;
+}
+
+
+/*
+    Clamps the top-left coordinate of a view along one axis so that the view stays on the board
+    pos: wanted coordinate (may be negative)
+    shown: # of board cells covered by the view along the axis
+    size: board size along the axis
+*/
+static
+size_t clamp_view(long pos, size_t shown, size_t size) {
+    size_t max = (shown >= size) ? 0 : size - shown;
+    if (pos < 0) {
+        return 0;
+    }
+    return ((size_t)pos > max) ? max : (size_t)pos;
+}
+
+
+void view_init(viewport* V, size_t n_rows, size_t n_cols, size_t zoom, size_t lines, size_t cols) {
+    V->n_rows = n_rows;
+    V->n_cols = n_cols;
+    V->max_rows = (lines > STATUS_LINES) ? lines - STATUS_LINES : 1;
+    V->max_cols = (cols > 3) ? (cols - 3) / 2 : 1;                  // 2 characters per cell + the borders
+    V->y = 0;
+    V->x = 0;
+    V->rows = 0;
+    V->cols = 0;
+    V->zoom = 1;
+    view_move(V, zoom ? zoom : fit_zoom(V), 0, 0);
+}
+
+
+void view_move(viewport* V, size_t zoom, long dy, long dx) {
+    size_t fit = fit_zoom(V);
+    if (zoom < 1) zoom = 1;
+    if (zoom > fit) zoom = fit;
+    long cy = V->y + V->rows * V->zoom / 2;                         // centre of the view, kept when zooming
+    long cx = V->x + V->cols * V->zoom / 2;
+
+    V->zoom = zoom;
+    V->rows = (V->n_rows + zoom - 1) / zoom;
+    V->cols = (V->n_cols + zoom - 1) / zoom;
+    if (V->rows > V->max_rows) V->rows = V->max_rows;
+    if (V->cols > V->max_cols) V->cols = V->max_cols;
+    V->y = clamp_view(cy - (long)(V->rows * zoom / 2) + dy * (long)zoom, V->rows * zoom, V->n_rows);
+    V->x = clamp_view(cx - (long)(V->cols * zoom / 2) + dx * (long)zoom, V->cols * zoom, V->n_cols);
+}
+
+
+void view_follow(viewport* V, size_t i, size_t j) {
+    size_t h = V->rows * V->zoom;
+    size_t w = V->cols * V->zoom;
+    if (i < V->y) {
+        V->y = i;
+    } else if (i >= V->y + h) {
+        V->y = clamp_view((long)(i + 1 - h), h, V->n_rows);
+    }
+    if (j < V->x) {
+        V->x = j;
+    } else if (j >= V->x + w) {
+        V->x = clamp_view((long)(j + 1 - w), w, V->n_cols);
+    }
+}
+
+
+/*
+    # of living cells in rows [i0, i1), columns [j0, j1) of a board
+*/
+static
+size_t count_block(const board* B, size_t i0, size_t i1, size_t j0, size_t j1) {
+    size_t count = 0;
+    size_t w0 = j0 >> 6;
+    size_t w1 = (j1 - 1) >> 6;
+    uint64_t first = ~(uint64_t)0 << (j0 & 63);
+    uint64_t last = (j1 & 63) ? ((uint64_t)1 << (j1 & 63)) - 1 : ~(uint64_t)0;
+    for (size_t i = i0; i < i1; i++) {
+        const uint64_t* row = board_row(B, i + 1) + 1;
+        for (size_t w = w0; w <= w1; w++) {
+            uint64_t mask = ((w == w0) ? first : ~(uint64_t)0) & ((w == w1) ? last : ~(uint64_t)0);
+            count += __builtin_popcountll(row[w] & mask);
+        }
+    }
+    return count;
+}
+
+
+char view_char(const board* B, const viewport* V, size_t sy, size_t sx) {
+    if (V->zoom == 1) {
+        return get_cell(B, V->y + sy, V->x + sx) ? 'O' : ' ';
+    }
+    size_t i0 = V->y + sy * V->zoom;
+    size_t j0 = V->x + sx * V->zoom;
+    size_t i1 = (i0 + V->zoom < V->n_rows) ? i0 + V->zoom : V->n_rows;    // the last blocks may be cut off
+    size_t j1 = (j0 + V->zoom < V->n_cols) ? j0 + V->zoom : V->n_cols;
+    size_t count = count_block(B, i0, i1, j0, j1);
+    size_t area = (i1 - i0) * (j1 - j0);
+    return VIEW_SHADES[count ? 1 + (count - 1) * 9 / area : 0];     // any living cell shows, only a full block is '@'
+}
+
+
+void draw_view(const board* B, const viewport* V, size_t starty, char* shown) {
+    for (size_t sy = 0; sy < V->rows; sy++) {
+        for (size_t sx = 0; sx < V->cols; sx++) {
+            char c = view_char(B, V, sy, sx);
+            mvaddch(sy + starty, (sx * 2) + 2, c);
+            if (shown) {
+                shown[sy * V->max_cols + sx] = c;
             }
         }
     }
 }
 
 
-void draw_cursor(size_t ypos, size_t xpos, size_t starty, bool erase) {
+renderer* create_renderer(const game_state* G, size_t starty) {
+    renderer* R = game_malloc(sizeof(renderer));
+    size_t n_tiles = G->n_tile_rows * G->n_tile_cols;
+    for (int k = 0; k < 3; k++) {
+        frame* f = &R->frames[k];
+        f->B = create_board(G->n_rows, G->n_cols);
+        board_copy(f->B, G->B);
+        f->tile_gen = game_malloc(n_tiles * sizeof(size_t));
+        memcpy(f->tile_gen, G->tile_gen, n_tiles * sizeof(size_t));
+        f->generation = G->generation;
+        f->epoch = G->epoch;
+        f->updates = G->updates;
+    }
+    R->latest = 0;
+    R->back = 1;
+    R->front = 2;
+    R->published = 0;
+    R->consumed = 0;
+    R->shown = create_board(G->n_rows, G->n_cols);
+    board_copy(R->shown, G->B);
+    R->shown_gen = G->generation;
+    R->shown_epoch = G->epoch;
+    R->starty = starty;
+    R->view = G->view;
+    R->view_pending = false;
+    R->chars = game_malloc(R->view.max_rows * R->view.max_cols);
+    R->dirty = game_calloc(R->view.max_rows * R->view.max_cols, sizeof(bool));
+    for (size_t sy = 0; sy < R->view.rows; sy++) {                 // what draw_board left on screen
+        for (size_t sx = 0; sx < R->view.cols; sx++) {
+            R->chars[sy * R->view.max_cols + sx] = view_char(R->shown, &R->view, sy, sx);
+        }
+    }
+    return R;
+}
+
+
+void destroy_renderer(renderer* R) {
+    for (int k = 0; k < 3; k++) {
+        destroy_board(R->frames[k].B);
+        free(R->frames[k].tile_gen);
+    }
+    destroy_board(R->shown);
+    free(R->chars);
+    free(R->dirty);
+    free(R);
+}
+
+
+/*
+    Copies rows [r0, r1) of data word w from one board to another
+*/
+static inline
+void copy_tile(board* dst, const board* src, size_t r0, size_t r1, size_t w) {
+    for (size_t i = r0 + 1; i < r1 + 1; i++) {
+        board_row(dst, i)[w] = board_row(src, i)[w];
+    }
+}
+
+
+void render_publish(renderer* R, const game_state* G) {
+    frame* f = &R->frames[R->back];
+    size_t tc = G->n_tile_cols;
+    bool full = (f->epoch != G->epoch);                             // the board was replaced since the frame was filled
+    for (size_t t = 0; t < G->n_tile_rows * tc; t++) {
+        if (G->tile_gen[t] <= f->generation && !full) {
+            continue;                                               // unchanged since the frame was last filled
+        }
+        size_t r1 = (t / tc + 1) * TILE_ROWS;
+        copy_tile(f->B, G->B, (t / tc) * TILE_ROWS, (r1 < G->n_rows) ? r1 : G->n_rows, t % tc + 1);
+        f->tile_gen[t] = G->tile_gen[t];
+    }
+    f->generation = G->generation;
+    f->epoch = G->epoch;
+    f->updates = G->updates;
+    R->back = atomic_exchange(&R->latest, R->back | FRAME_FRESH) & ~FRAME_FRESH;
+    atomic_fetch_add(&R->published, 1);
+}
+
+
+bool render_consume(renderer* R) {
+    if (!(atomic_load(&R->latest) & FRAME_FRESH)) {
+        return false;
+    }
+    R->front = atomic_exchange(&R->latest, R->front) & ~FRAME_FRESH;
+    R->consumed++;
+    return true;
+}
+
+
+const frame* render_draw(renderer* R) {
+    const frame* f = &R->frames[R->front];
+    const viewport* V = &R->view;
+    size_t K = V->zoom;
+    size_t view_y1 = V->y + V->rows * K;                            // end of the board cells covered by the view
+    size_t view_x1 = V->x + V->cols * K;
+    size_t tc = R->shown->stride - 2;
+    size_t n_tiles = ((R->shown->n_rows + TILE_ROWS - 1) / TILE_ROWS) * tc;
+    bool full = (f->epoch != R->shown_epoch);                       // e.g. rewound: every tile is compared with the screen
+    for (size_t t = 0; t < n_tiles; t++) {
+        if (f->tile_gen[t] <= R->shown_gen && !full) {
+            continue;                                               // unchanged since the board on screen
+        }
+        size_t w = t % tc + 1;
+        size_t i0 = (t / tc) * TILE_ROWS;
+        size_t i1 = i0 + TILE_ROWS;
+        if (i1 > R->shown->n_rows) i1 = R->shown->n_rows;
+        size_t j0 = (w - 1) * 64;
+        size_t j1 = (j0 + 64 < R->shown->n_cols) ? j0 + 64 : R->shown->n_cols;
+        bool in_view = i0 < view_y1 && i1 > V->y && j0 < view_x1 && j1 > V->x;
+        if (in_view && K > 1) {                                     // the blocks overlapping the tile are recounted below
+            size_t sy1 = ((i1 < view_y1 ? i1 : view_y1) - 1 - V->y) / K;
+            size_t sx1 = ((j1 < view_x1 ? j1 : view_x1) - 1 - V->x) / K;
+            for (size_t sy = (i0 > V->y ? i0 - V->y : 0) / K; sy <= sy1; sy++) {
+                for (size_t sx = (j0 > V->x ? j0 - V->x : 0) / K; sx <= sx1; sx++) {
+                    R->dirty[sy * V->max_cols + sx] = true;
+                }
+            }
+        }
+        for (size_t i = i0 + 1; i < i1 + 1; i++) {
+            uint64_t* shown = &board_row(R->shown, i)[w];
+            uint64_t now = board_row(f->B, i)[w];
+            for (uint64_t flips = (in_view && K == 1) ? *shown ^ now : 0; flips; flips &= flips - 1) {   // one cell per set bit
+                int b = __builtin_ctzll(flips);
+                size_t sy, sx;
+                if (view_cell(V, i - 1, j0 + b, &sy, &sx)) {
+                    char c = ((now >> b) & 1) ? 'O' : ' ';
+                    mvaddch(sy + R->starty, (sx * 2) + 2, c);
+                    R->chars[sy * V->max_cols + sx] = c;
+                }
+            }
+            *shown = now;                                           // cells outside the view are tracked too
+        }
+    }
+    if (K > 1) {
+        for (size_t sy = 0; sy < V->rows; sy++) {                   // bounded by the terminal size, not the board
+            for (size_t sx = 0; sx < V->cols; sx++) {
+                size_t k = sy * V->max_cols + sx;
+                if (!R->dirty[k]) {
+                    continue;
+                }
+                R->dirty[k] = false;
+                char c = view_char(R->shown, V, sy, sx);
+                if (c != R->chars[k]) {
+                    mvaddch(sy + R->starty, (sx * 2) + 2, c);
+                    R->chars[k] = c;
+                }
+            }
+        }
+    }
+    R->shown_gen = f->generation;
+    R->shown_epoch = f->epoch;
+    return f;
+}
+
+
+bool render_view(renderer* R, game_state* G) {
+    if (!atomic_exchange(&R->view_pending, false)) {
+        return false;
+    }
+    pthread_mutex_lock(&G->mtx);
+    R->view = G->view;
+    pthread_mutex_unlock(&G->mtx);
+
+    move(R->starty - 1, 0);                                         // the size of the box may have changed
+    clrtobot();
+    WIN win;
+    init_win_params(&win, R->view.rows, R->view.cols, R->starty - 1, 0);
+    create_box(&win, TRUE);
+    draw_view(R->shown, &R->view, R->starty, R->chars);
+    return true;
+}
+
+
+void draw_cursor(const viewport* V, size_t ypos, size_t xpos, size_t starty, bool erase) {
+   if (!view_cell(V, ypos, xpos, &ypos, &xpos)) {
+      return;                                                               // scrolled out of the view
+   }
    if (!erase) {
       mvaddch(ypos + starty, (xpos * 2) + 1, '[');
       mvaddch(ypos + starty, (xpos * 2) + 3, ']');
@@ -220,21 +1324,46 @@ void print_lastcom(int com, size_t n_rows) {
         case START_GAME: mvprintw(ypos, 0, "Last command: START GAME"); clrtoeol(); break;
         case SPAWN_LIFE: mvprintw(ypos, 0, "Last command: SPAWN/KILL"); clrtoeol(); break;
         case TOGGLE_TOROIDAL: mvprintw(ypos, 0, "Last command: CHANGE GEOMETRY"); clrtoeol(); break;
+        case INC_FFWD: mvprintw(ypos, 0, "Last command: FAST-FORWARD"); clrtoeol(); break;
+        case DEC_FFWD: mvprintw(ypos, 0, "Last command: SLOW DOWN"); clrtoeol(); break;
+        case PAUSE_GAME: mvprintw(ypos, 0, "Last command: PAUSE"); clrtoeol(); break;
+        case RESUME_GAME: mvprintw(ypos, 0, "Last command: RESUME"); clrtoeol(); break;
+        case STEP_HISTORY: mvprintw(ypos, 0, "Last command: STEP"); clrtoeol(); break;
+        case EDIT_BOARD: mvprintw(ypos, 0, "Last command: EDIT BOARD"); clrtoeol(); break;
    }
 }
 
 
-void print_gameParams(bool toroidal, size_t upd_rate, size_t maxiters, size_t n_rows) {
+void print_gameParams(bool toroidal, size_t upd_rate, size_t upd_per_frame, const pacer* pace, size_t maxiters, size_t n_rows) {
     int ypos = n_rows + 5;
+    mvprintw(ypos, 0, "Update rate:%3zu /s", upd_rate); clrtoeol();
+    if (pace && upd_per_frame) {                                    // not paced at full speed
+        printw(" (achieved %.1f /s, jitter %.2f ms, %zu overruns)", pacer_rate(pace), pacer_jitter_ms(pace),
+               atomic_load_explicit(&pace->overruns, memory_order_relaxed));
+    }
     if (toroidal) {
-        mvprintw(ypos, 0, "Update rate:%3d /s | maxiters: %4d | Board geometry: TOROIDAL", upd_rate, maxiters); clrtoeol();
+        printw(" | maxiters: %4zu | Board geometry: TOROIDAL", maxiters);
     } else {
-        mvprintw(ypos, 0, "Update rate:%3d /s | maxiters: %4d | Board geometry: FLAT/WALLED", upd_rate, maxiters); clrtoeol();
+        printw(" | maxiters: %4zu | Board geometry: FLAT/WALLED", maxiters);
+    }
+    if (upd_per_frame) {
+        printw(" | Fast-forward: x%zu", upd_per_frame);
+    } else {
+        printw(" | Fast-forward: FULL SPEED");
     }
 }
 
 
-static inline
-bool test_life(bool current, size_t nbrs) {
-    return (nbrs == 3 || (current && nbrs == 2));           // 3 living neighbours always gives life. 2 living neighbours also does IFF tile is currently alive.
-}                                                           
\ No newline at end of file
+
+void print_perfStats(const perf_counters* P, size_t n_rows) {
+    int ypos = n_rows + 6;
+    double ns = perf_ns_per_gen(P);
+    double secs = (clock_ns() - atomic_load(&P->start_ns)) * 1e-9;
+    size_t gens = atomic_load(&P->generations);
+    mvprintw(ypos, 0, "Update: %8.0f ns/gen | %.3g cells/s | %.1f gens/s | allocations: %zu",
+             ns, ns > 0 ? P->cells * 1e9 / ns : 0.0, secs > 0 ? gens / secs : 0.0, game_alloc_count() - atomic_load(&P->alloc_base)); clrtoeol();
+    size_t frames = atomic_load(&P->frames);
+    mvprintw(ypos + 1, 0, "Draw: %6.2f ms/frame | frames: %zu drawn of %zu published | waits: %.1f ms | sleep: %.1f s",
+             frames ? atomic_load(&P->draw_ns) * 1e-6 / frames : 0.0, frames, atomic_load(&P->published),
+             atomic_load(&P->wait_ns) * 1e-6, atomic_load(&P->sleep_ns) * 1e-9); clrtoeol();
+}
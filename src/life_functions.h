@@ -10,12 +10,18 @@
  -------------------------------------
  */
 
+#ifndef LIFE_FUNCTIONS_H
+#define LIFE_FUNCTIONS_H
+
 #include <stdlib.h>
+#include <stdint.h>
 #include <pthread.h>
 #include <stdbool.h>
 #include <ncurses/ncurses.h>
 #include <stdatomic.h>
 
+#include "rules.h"
+
 enum input_enum {
     EMPTY = 0,
     GO_LEFT,
@@ -28,9 +34,79 @@ enum input_enum {
     START_GAME,
     SPAWN_LIFE,
     TOGGLE_TOROIDAL,
+    INC_FFWD,
+    DEC_FFWD,
+    PAUSE_GAME,
+    RESUME_GAME,
+    STEP_HISTORY,
+    EDIT_BOARD,
+};
+
+
+#define TILE_ROWS 64            // active tiles are TILE_ROWS rows x 1 word (64 columns)
+
+#define MAX_UPDATES_PER_FRAME 65536     // fast-forward beyond this runs the game at full speed
+#define SAMPLE_RATE 60                  // frames per second shown while the game runs at full speed
+
+#define BLOCK_BYTES (256 << 10)         // scratch rows of one band of temporal blocking (about a private L2 cache)
+
+
+enum engine_enum {
+    ENGINE_BITWISE = 0,         // bit-packed board, 64 cells per word updated with full-adder logic
+    ENGINE_NAIVE,               // per-cell neighbour count (reference implementation)
+    ENGINE_HASHLIFE,            // memoised quadtree on an unbounded plane, the board is a window onto it
+    ENGINE_SPARSE,              // hash map of 64 x 64 chunks on an unbounded plane, the board is a window onto it
+    ENGINE_LUT,                 // 2 x 2 blocks looked up from their 4 x 4 neighbourhood in a precomputed table
 };
 
 
+#define LUT_SIZE 65536          // # of entries of the block table: one per 4 x 4 neighbourhood (16 bits)
+
+
+/*
+    Bit-packed game board: each row is an array of 64-bit words, one bit per cell.
+    Cell (i, j) is bit (j % 64) of word (j / 64) + 1 in padded row i + 1.
+    Padded rows 0 and n_rows + 1 and the cells at columns -1 (bit 63 of word 0) and n_cols
+    form a one-cell halo around the board that is filled in before each update.
+    Bits past column n_cols are always 0.
+*/
+typedef struct _board {
+    size_t n_rows;              // # of rows (excluding the halo)
+    size_t n_cols;              // # of columns (excluding the halo)
+    size_t stride;              // # of words per padded row
+    uint64_t* data;             // (n_rows + 2) * stride words
+    void* map_base;             // file mapping that holds data (NULL: data is heap allocated, see map_checkpoint)
+    size_t map_size;            // size of the mapping in bytes
+} board;
+
+
+enum stop_enum {
+    STOP_NONE = 0,              // game still running
+    STOP_MAXITERS,              // maximum # of iterations reached
+    STOP_STEADY,                // no tile changed in the last update
+    STOP_CYCLE,                 // board returned to an earlier state (oscillator, glider circling a torus, ...)
+    STOP_FAILED,                // the engine could not continue (Hashlife memory budget exceeded)
+};
+
+
+#define STATUS_LINES 8            // screen lines used around the board: 2 help lines, 2 borders and 4 status lines
+#define VIEW_SHADES " .:-=+*#%@"    // density shading of zoomed-out blocks, from empty to full
+
+
+/*
+    Window of the board shown on the terminal. At zoom 1 each screen cell is one board cell; at zoom K each
+    screen cell summarises a K x K block of cells with a density shade (see VIEW_SHADES), so drawing costs
+    at most rows x cols characters whatever the size of the board.
+*/
+typedef struct _viewport {
+    size_t zoom;                // board cells per screen cell side
+    size_t y, x;                // board cell at the top-left corner of the view
+    size_t rows, cols;          // # of screen cells shown
+    size_t max_rows, max_cols;  // # of screen cells that fit in the terminal
+    size_t n_rows, n_cols;      // board size
+} viewport;
+
+
 typedef struct _win_border_struct {
     chtype ls, rs, ts, bs, tl, tr, bl, br;
 } WIN_BORDER;
@@ -43,36 +119,125 @@ typedef struct _WIN_struct {
 } WIN;
 
 
+/*
+    Result of updating (part of) the board
+*/
+typedef struct _step_result {
+    size_t changed;             // # of tiles whose life/death status changed
+    uint64_t hash;              // XOR of the changes to the board hash (see word_hash)
+    size_t births;              // # of changed tiles that came to life (the others died)
+    size_t top, bottom;         // first/last row with living tiles (top > bottom: none), only kept when G->stats is set
+    size_t left, right;         // first/last column with living tiles
+    size_t last;                // # of tiles changed by the last generation of a multi-generation update (temporal blocking)
+} step_result;
+
+
+/*
+    Result of updating nothing: no changes and an empty bounding box
+*/
+static inline
+step_result step_init(void) {
+    return (step_result){ 0, 0, 0, SIZE_MAX, 0, SIZE_MAX, 0, 0 };
+}
+
+
+/*
+    Adds the result of updating another part of the board to a result
+*/
+static inline
+void step_merge(step_result* res, const step_result* part) {
+    res->changed += part->changed;
+    res->hash ^= part->hash;
+    res->births += part->births;
+    res->last += part->last;
+    if (part->top < res->top) res->top = part->top;
+    if (part->bottom > res->bottom) res->bottom = part->bottom;
+    if (part->left < res->left) res->left = part->left;
+    if (part->right > res->right) res->right = part->right;
+}
+
+
+/*
+    Grows the bounding box of a result to the living tiles of one data word
+    i: board row of the word
+    w: index of the word within the row (0: columns 0-63)
+*/
+static inline
+void step_bounds(step_result* res, size_t i, size_t w, uint64_t word) {
+    if (!word) {
+        return;
+    }
+    size_t l = w * 64 + __builtin_ctzll(word);
+    size_t r = w * 64 + 63 - __builtin_clzll(word);
+    if (i < res->top) res->top = i;
+    if (i > res->bottom) res->bottom = i;
+    if (l < res->left) res->left = l;
+    if (r > res->right) res->right = r;
+}
+
+
 typedef struct _game_state {
     // thread-related variables
     pthread_mutex_t mtx;        // mutex that protects the game board 
     pthread_cond_t draw_inp;    // cond to draw after user input
-    pthread_cond_t draw_upd;    // cond to draw after game state update
-    pthread_cond_t upd;         // cond to update the game board
 
     // game parameters
     size_t update_rate;                 // stores the desired game updates per second
+    size_t updates_per_frame;   // # of updates computed per displayed frame (0: full speed, the display samples the game)
     size_t n_rows;              // # of rows (board height) 
     size_t n_cols;              // # of columns (board width)
     size_t maxiters;            // maximum # of iterations before game ends
     bool toroidal;              // true: toroidal/donut shaped geometry; false: walled
+    size_t engine;              // update algorithm used by game_update (see engine_enum)
+    struct _worker_pool* pool;  // worker threads that update row bands in parallel (NULL: single-threaded)
+    struct _hashlife* hl;       // Hashlife universe (ENGINE_HASHLIFE only)
+    struct _sparse_grid* sparse;    // chunked universe (ENGINE_SPARSE only)
+    size_t gens_per_update;     // # of generations the Hashlife and bitwise (temporal blocking) engines advance per update
+    size_t jump;                // # of generations the Hashlife engine skips before the first update (cleared by game_start)
+    life_rule rule;             // birth/survival rule, compiled into the kernel used by every engine
+    uint8_t* lut;               // next state of the 2 x 2 centre of every 4 x 4 neighbourhood (ENGINE_LUT only)
+    uint64_t* block;            // 2 scratch buffers per band for temporal blocking (ENGINE_BITWISE, gens_per_update > 1)
+    size_t block_rows;          // # of board rows stepped at a time by temporal blocking
 
     // dynamic game state variables
     size_t xpos;                // stores the cursor x-coordinate
     size_t ypos;                // stores the cursor y-coordinate
     size_t last_command;        // stores the most recent user input
     size_t starty;              // game board y-coordinate offset
+    viewport view;              // window of the board shown on the terminal (see view_init)
 
     // iterators/counters
     size_t spawns;              // # of times user spawned/despawned life
     size_t updates;             // # of times the board has been updated
-    size_t drawn;               // # of times the board has been drawn
+    size_t generation;          // # of generations computed (updates * gens_per_update for Hashlife and temporal blocking)
+    uint64_t hash;              // hash of the current board (of the whole universe for ENGINE_SPARSE), updated incrementally
+    size_t stop_reason;         // why the game ended (see stop_enum)
+    size_t epoch;               // bumped whenever the board is replaced rather than stepped (edited again or rewound)
+    struct _cycle_detector* cycle;  // recent board hashes, used to detect when the board enters a loop
+    struct _checkpointer* ckpt; // background checkpoint writer (NULL: no checkpoints)
+    struct _renderer* renderer; // display state of the game phase (see render_publish)
+    struct _perf_counters* perf;    // hot-path timers and counters (NULL: not instrumented, see perf.h)
+    struct _stats_writer* stats;    // per-generation statistics log (NULL: not logged, see gen_stats.h)
+    struct _recorder* rec;      // background frame exporter (NULL: not recording, see recorder.h)
+    struct _pacer* pacer;       // paces the update thread of the game phase (NULL: not paced, see pacer.h)
+    struct _history* hist;      // generations kept for rewinding (NULL: no history, see history.h)
+    size_t population;          // # of living tiles on the board, kept up to date while G->stats is set
 
     
     // game state control variables
     atomic_bool inp_over;       // set to true when user input phase is completed 
     atomic_bool finished;       // set to true when the game is over
-    void* Mv;                   // void pointer to the game board matrix
+    atomic_bool paused;         // set to true while the game phase is paused (the board can then be rewound)
+    atomic_long seek;           // # of updates to step forward (> 0) or back (< 0) while paused, taken by the update thread
+    atomic_bool edit;           // set to true to leave a paused game for the input phase
+    board* B;                   // pointer to the bit-packed game board (current generation)
+    board* next;                // back buffer that receives the next generation, swapped with B after each update
+
+    // active tiles (bitwise engine): only tiles that changed in the last update, or border one, are recomputed
+    size_t n_tile_rows;         // # of tiles vertically
+    size_t n_tile_cols;         // # of tiles horizontally (= data words per row)
+    size_t* tile_gen;           // generation in which each tile last changed (kept by every engine, used by the renderer)
+    bool* active;               // tiles to recompute in the current update
 
 } game_state;
 
@@ -95,17 +260,240 @@ void init_game(game_state* G, size_t rows, size_t cols, size_t iters, bool toroi
 void destroy_game(game_state*);
 
 
+/*
+    malloc/calloc wrappers used for all game memory; every call increments a global allocation counter
+*/
+void* game_malloc(size_t size);
+void* game_calloc(size_t n, size_t size);
+
+
+/*
+    returns: # of allocations made through game_malloc/game_calloc so far (used to check that
+    stepping the game does not allocate)
+*/
+size_t game_alloc_count(void);
+
+
 /*  
-    Allocates memory for a matrix of boolean values and returns a null pointer to
-    an array of pointers to the rows of the matrix.
-    Cast to bool** to access the matrix. M[i][j] notation works and data is stored contiguously
+    Allocates a zeroed bit-packed board (including the halo)
     Params:
     rows: # of rows
     cols: # of cols
-    returns: void pointer to the START OF ARRAY OF POINTERS to the matrix rows
-    note: Start of data block can be accessed using (bool**)returned_voidptr[0]
+    returns: pointer to the new board
 */ 
-void* create_matrix(size_t rows, size_t cols);
+board* create_board(size_t rows, size_t cols);
+
+
+/*
+    Deallocates a board created with create_board
+*/
+void destroy_board(board*);
+
+
+/*
+    Returns a pointer to the first word of padded row i (row i - 1 of the board, 0 and n_rows + 1 are halo rows)
+*/
+static inline
+uint64_t* board_row(const board* B, size_t i) {
+    return B->data + i * B->stride;
+}
+
+
+/*
+    Reads the life status of the cell at row i, column j (0-indexed, excluding the halo)
+*/
+static inline
+bool get_cell(const board* B, size_t i, size_t j) {
+    const uint64_t* row = board_row(B, i + 1);
+    return (row[(j >> 6) + 1] >> (j & 63)) & 1;
+}
+
+
+/*
+    Sets the life status of the cell at row i, column j (0-indexed, excluding the halo)
+*/
+static inline
+void set_cell(board* B, size_t i, size_t j, bool alive) {
+    uint64_t* row = board_row(B, i + 1);
+    uint64_t bit = (uint64_t)1 << (j & 63);
+    if (alive) {
+        row[(j >> 6) + 1] |= bit;
+    } else {
+        row[(j >> 6) + 1] &= ~bit;
+    }
+}
+
+
+/*
+    Mask of the valid bits in the last data word of each row (bits past column n_cols are not part of the board)
+*/
+static inline
+uint64_t last_word_mask(const board* B) {
+    return (B->n_cols & 63) ? ((uint64_t)1 << (B->n_cols & 63)) - 1 : ~(uint64_t)0;
+}
+
+
+/*
+    Sets the left and right halo cells of a padded row (toroidal: copies of the last and first cells | walled: dead)
+*/
+static inline
+void fill_row_halo(uint64_t* row, size_t n_cols, bool toroidal) {
+    size_t hi = 64 + n_cols;                                        // bit index of the right halo cell within a padded row
+    uint64_t left = 0;
+    uint64_t right = 0;
+    if (toroidal) {
+        left = (row[(hi - 1) >> 6] >> ((hi - 1) & 63)) & 1;         // last cell of the row
+        right = row[1] & 1;                                         // first cell of the row
+    }
+    row[0] = left << 63;
+    row[hi >> 6] = (row[hi >> 6] & ~((uint64_t)1 << (hi & 63))) | (right << (hi & 63));
+}
+
+
+/*
+    Contribution of one data word to the board hash (Zobrist-style: the board hash is the XOR of the
+    contributions of all words, so changing a word only needs the old and new contributions)
+    pos: position of the word within the padded board data
+    value: word value (empty words contribute 0)
+*/
+static inline
+uint64_t word_hash(size_t pos, uint64_t value) {
+    if (!value) {
+        return 0;
+    }
+    uint64_t x = value ^ (pos * 0x9E3779B97F4A7C15ull);
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+    return x ^ (x >> 31);
+}
+
+
+/*
+    Counts the living neighbours of one word (64 tiles) using bitwise full-adder logic.
+    The count of each tile is spread over 4 words, one per bit: cnt[0] holds the 1s, ..., cnt[3] the 8s.
+    up, mid, dn: padded rows above, at and below the word
+    w: word index within the rows
+*/
+static inline
+void count_neighbours(const uint64_t* up, const uint64_t* mid, const uint64_t* dn, size_t w, uint64_t cnt[4]) {
+    // the 8 neighbours of every tile in the word, lined up with the tile's own bit
+    uint64_t ul = (up[w] << 1) | (up[w - 1] >> 63);
+    uint64_t u  = up[w];
+    uint64_t ur = (up[w] >> 1) | (up[w + 1] << 63);
+    uint64_t l  = (mid[w] << 1) | (mid[w - 1] >> 63);
+    uint64_t r  = (mid[w] >> 1) | (mid[w + 1] << 63);
+    uint64_t dl = (dn[w] << 1) | (dn[w - 1] >> 63);
+    uint64_t d  = dn[w];
+    uint64_t dr = (dn[w] >> 1) | (dn[w + 1] << 63);
+
+    // full adders: sum the top 3, the bottom 3 and the middle 2 neighbours
+    uint64_t s_up = ul ^ u ^ ur;
+    uint64_t c_up = (ul & u) | (ur & (ul ^ u));
+    uint64_t s_dn = dl ^ d ^ dr;
+    uint64_t c_dn = (dl & d) | (dr & (dl ^ d));
+    uint64_t s_md = l ^ r;
+    uint64_t c_md = l & r;
+
+    // combine the partial sums into the bits of the neighbour count (b3 b2 b1 b0)
+    uint64_t c0 = (s_up & s_dn) | (s_md & (s_up ^ s_dn));           // carry into the 2s
+    uint64_t t = c_up ^ c_dn ^ c_md;
+    uint64_t c1 = (c_up & c_dn) | (c_md & (c_up ^ c_dn));           // carry into the 4s
+    uint64_t c2 = t & c0;                                           // second carry into the 4s
+    cnt[0] = s_up ^ s_dn ^ s_md;
+    cnt[1] = t ^ c0;
+    cnt[2] = c1 ^ c2;
+    cnt[3] = c1 & c2;
+}
+
+
+/*
+    Computes one word (64 tiles) of the next generation under B3/S23.
+    Shared by the engines that store cells as bit-packed rows.
+    up, mid, dn: padded rows above, at and below the word
+    w: word index within the rows
+*/
+static inline
+uint64_t life_word(const uint64_t* up, const uint64_t* mid, const uint64_t* dn, size_t w) {
+    uint64_t cnt[4];
+    count_neighbours(up, mid, dn, w, cnt);
+
+    // 3 living neighbours always gives life. 2 living neighbours also does IFF tile is currently alive.
+    return cnt[1] & ~cnt[2] & ~cnt[3] & (cnt[0] | mid[w]);
+}
+
+
+/*
+    Computes one word (64 tiles) of the next generation under any rule compiled by rule_init (KERNEL_TABLE).
+    Each of the 9 possible counts is matched against the bit-sliced count of every tile at once and selects
+    the birth or survival table entry, so the cost is the same for every rule and there are no branches.
+*/
+static inline
+uint64_t rule_word(const life_rule* rule, const uint64_t* up, const uint64_t* mid, const uint64_t* dn, size_t w) {
+    uint64_t cnt[4];
+    count_neighbours(up, mid, dn, w, cnt);
+
+    uint64_t alive = mid[w];
+    uint64_t bit[3][2] = { { ~cnt[0], cnt[0] }, { ~cnt[1], cnt[1] }, { ~cnt[2], cnt[2] } };
+    uint64_t next = cnt[3] & ((rule->born[8] & ~alive) | (rule->kept[8] & alive));   // 8 is the only count with b3 set
+    for (int n = 0; n < 8; n++) {
+        uint64_t eq = ~cnt[3] & bit[0][n & 1] & bit[1][(n >> 1) & 1] & bit[2][n >> 2];
+        next |= eq & ((rule->born[n] & ~alive) | (rule->kept[n] & alive));
+    }
+    return next;
+}
+
+
+/*
+    Computes the hash of a board from scratch (see word_hash)
+*/
+uint64_t board_hash(const board*);
+
+
+/*
+    returns: true if two boards of the same size have the same living tiles (the halo is ignored)
+*/
+bool board_equal(const board*, const board*);
+
+
+/*
+    Copies the contents of a board (including the halo) to a board of the same size
+*/
+void board_copy(board* dst, const board* src);
+
+
+/*
+    Brings a copy of the board of generation since up to date by copying the tiles that changed after it
+    (see tile_gen), or the whole board if it was replaced since (epoch is G->epoch at the time of the copy)
+*/
+void board_copy_changed(board* dst, const game_state* G, size_t since, size_t epoch);
+
+
+/*
+    returns: # of living tiles on the board
+*/
+size_t board_population(const board*);
+
+
+/*
+    Fills the board with random tiles from a deterministic PRNG (the same seed always gives the same board)
+    density: probability of each tile being alive
+    seed: PRNG seed
+*/
+void board_randomise(board*, double density, uint64_t seed);
+
+
+/*
+    Fills the data words of one padded row with random tiles, continuing the PRNG sequence in state
+    (board_randomise fills rows 1 to n_rows in order with state starting at the seed)
+*/
+void random_row(uint64_t* row, size_t n_cols, double density, uint64_t* state);
+
+
+/*
+    Fills in the halo cells around the board
+    toroidal: true: copy values from the opposite edge | false: set the halo to 0s (walls)
+*/
+void board_fill_halo(board* B, bool toroidal);
 
 
 /*
@@ -128,13 +516,62 @@ void init_win_params(WIN * p_win, size_t n_rows, size_t n_cols, size_t starty, s
 void create_box(WIN * win, bool flag);
 
 
+/*
+    Prepares the selected engine for the game phase (e.g. loads the board drawn in the input phase into
+    the Hashlife universe) and records the board as a keyframe of G->hist, dropping the generations after it.
+    Called before the first game_update, and again whenever the game goes on from a board that was edited or rewound.
+    returns: true on success | false if the engine could not take the board (Hashlife memory budget exceeded)
+*/
+bool game_start(game_state*);
+
+
 /*
     Updates the game board state by one iteration (spawning/killing based on the rules)
-    returns: number of updates completed
+    using the engine selected in G->engine. The next generation is written to G->next and the
+    two boards are swapped; no memory is allocated (except by the sparse engine when the universe grows).
+    If G->stats is set, the births, deaths, population and bounding box of the board are gathered while
+    stepping and handed to the statistics writer.
+    The Hashlife and bitwise engines advance gens_per_update generations per update (the bitwise engine with
+    temporal blocking).
+    returns: number of tiles whose life/death status changed (anywhere in the universe for ENGINE_SPARSE, in the
+    last generation with temporal blocking), -1 if the engine failed (Hashlife memory budget exceeded)
 */
 int game_update(game_state*);
 
 
+/*
+    Advances the game by one update and checks the stopping conditions: steady state, return to an earlier
+    board (cycle), maximum # of iterations and engine failure. Every G->ckpt->interval updates the board is
+    handed to the checkpoint writer (skipped if it is still busy). The update is timed into G->perf and its flip
+    list recorded in G->hist if set.
+    returns: true if the game goes on | false if it is over (the reason is stored in G->stop_reason)
+*/
+bool game_advance(game_state*);
+
+
+/*
+    Computes rows [r0, r1) of the next generation (of generation + gens_per_update with temporal blocking) into
+    G->next using the engine selected in G->engine. The halo of G->B must be filled in. Safe to call
+    concurrently on disjoint row ranges that start on a multiple of TILE_ROWS.
+    band: index of the caller's band (0 to # of pool workers - 1), selects its temporal blocking scratch
+    returns: number of tiles in the range whose life/death status changed, the board hash update, the # of
+    births and (if G->stats is set) the bounding box of the living tiles in the range
+*/
+step_result update_rows(game_state* G, size_t r0, size_t r1, size_t band);
+
+
+/*
+    returns: name of a stop reason (see stop_enum) for status messages
+*/
+const char* stop_reason_name(size_t reason);
+
+
+/*
+    returns: monotonic clock reading in nanoseconds
+*/
+uint64_t clock_ns(void);
+
+
 /*
     Calls pthread_cond_timedwait with a wait time of 1 second
     returns: return value of pthread_cond_timedwait function call
@@ -143,19 +580,160 @@ int timed_cond_wait(pthread_cond_t*, pthread_mutex_t*);
 
 
 /*
-    Draws the game board on the ncurses window (note: refresh() must still be called)
+    Draws the part of the game board inside G->view on the ncurses window (note: refresh() must still be called)
 */
 void draw_board(game_state*);
 
 
 /*
-    Draws or erases the cursor at the given position on the ncurses window
+    Sets up a view of a board for a terminal of the given size, starting at the top-left corner
+    zoom: board cells per screen cell side (0: smallest zoom that shows the whole board)
+    lines, cols: terminal size (LINES, COLS)
+*/
+void view_init(viewport*, size_t n_rows, size_t n_cols, size_t zoom, size_t lines, size_t cols);
+
+
+/*
+    Changes the zoom (clamped to 1 .. the zoom that shows the whole board) and scrolls by dy, dx screen cells,
+    keeping the view on the board. Zooming keeps the centre of the view in place.
+*/
+void view_move(viewport*, size_t zoom, long dy, long dx);
+
+
+/*
+    Scrolls the view just enough to show board cell (i, j)
+*/
+void view_follow(viewport*, size_t i, size_t j);
+
+
+/*
+    Finds the screen cell that shows board cell (i, j)
+    sy, sx: receive the screen cell (row and column within the view)
+    returns: true if the cell is inside the view
+*/
+static inline
+bool view_cell(const viewport* V, size_t i, size_t j, size_t* sy, size_t* sx) {
+    if (i < V->y || j < V->x) {
+        return false;
+    }
+    *sy = (i - V->y) / V->zoom;
+    *sx = (j - V->x) / V->zoom;
+    return *sy < V->rows && *sx < V->cols;
+}
+
+
+/*
+    Character shown for screen cell (sy, sx) of a view of board B: 'O'/' ' at zoom 1, a density shade of the
+    K x K block otherwise (counted with popcounts over the bit-packed rows)
+*/
+char view_char(const board* B, const viewport* V, size_t sy, size_t sx);
+
+
+/*
+    Redraws every screen cell of a view of board B (note: refresh() must still be called)
+    shown: receives the character drawn in each screen cell (may be NULL)
+*/
+void draw_view(const board* B, const viewport* V, size_t starty, char* shown);
+
+
+#define FRAME_FRESH 4u            // flag set in renderer.latest while the latest frame has not been taken by the display
+
+
+/*
+    Copy of the game board handed from the simulator to the display
+*/
+typedef struct _frame {
+    board* B;                   // copy of the game board
+    size_t* tile_gen;           // generation in which each tile of the copy last changed
+    size_t generation;          // generation of the copy
+    size_t epoch;               // G->epoch of the copy (a frame of another epoch is refreshed in full)
+    size_t updates;             // # of updates at the time of the copy
+} frame;
+
+
+/*
+    Display state of the game phase. The simulator and the display share a lock-free triple buffer of frames:
+    the simulator fills its back frame and swaps it with the latest one, the display swaps its front frame with
+    the latest one whenever a fresh frame has been published. Neither side ever waits for the other; when the
+    display falls behind, the frames it did not take are overwritten (dropped).
+    Only the tiles that changed are copied into a frame (see tile_gen), and only the cells that differ from
+    what is on screen are redrawn.
+*/
+typedef struct _renderer {
+    frame frames[3];
+    atomic_uint latest;         // index of the latest published frame, | FRAME_FRESH until the display takes it
+    unsigned back;              // frame being filled (owned by the simulator)
+    unsigned front;             // frame being drawn (owned by the display)
+    atomic_size_t published;    // # of frames published by the simulator
+    size_t consumed;            // # of frames taken by the display
+
+    board* shown;               // board as of the last frame drawn (including the cells outside the view)
+    size_t shown_gen;           // generation of the board on screen
+    size_t shown_epoch;         // epoch of the board on screen (a frame of another epoch is compared in full)
+    size_t starty;              // game board y-offset
+
+    viewport view;              // view being drawn (owned by the display)
+    atomic_bool view_pending;   // set when G->view was changed and the display has not redrawn it yet
+    char* chars;                // character on screen in each screen cell of the view (max_rows x max_cols)
+    bool* dirty;                // zoomed-out screen cells whose block changed in the current frame
+} renderer;
+
+
+/*
+    Allocates a renderer for the game, assuming the current board is what is on screen in G->view
+    starty: game board y-offset
+    returns: pointer to the new renderer
+*/
+renderer* create_renderer(const game_state* G, size_t starty);
+
+
+/*
+    Deallocates a renderer
+*/
+void destroy_renderer(renderer*);
+
+
+/*
+    Simulator side: copies the tiles of the game board that changed since the back frame was last filled into
+    it and publishes it as the latest frame. Never blocks; cost is proportional to the # of changed tiles
+    (the whole board is copied once after it was replaced, see G->epoch).
+*/
+void render_publish(renderer*, const game_state* G);
+
+
+/*
+    Display side: takes the latest frame if one was published since the last call
+    returns: true if a new frame was taken (see render_draw) | false if the display is up to date
+*/
+bool render_consume(renderer*);
+
+
+/*
+    Redraws the screen cells of the view whose cells flipped between the board on screen and the last frame
+    taken by render_consume (note: refresh() must still be called). Flipped cells outside the view cost no
+    drawing; at zoom K only the blocks that contain a changed tile are recounted.
+    returns: the frame that was drawn
+*/
+const frame* render_draw(renderer*);
+
+
+/*
+    Display side: switches to the view requested in G->view (under G->mtx) and redraws all of it
+    (note: refresh() must still be called)
+    returns: true if the view changed and was redrawn | false if no change was pending
+*/
+bool render_view(renderer*, game_state* G);
+
+
+/*
+    Draws or erases the cursor at the given position on the ncurses window (nothing if it is outside the view)
+    V: view of the board
     ypos: y-coordinate of the cursor
     xpos: x-coordinate of the cursor
     starty: y-offset of the game board
     erase: true: erases the cursor from the given position | false: draws cursor at the given position
 */
-void draw_cursor(size_t ypos, size_t xpos, size_t starty, bool erase);
+void draw_cursor(const viewport* V, size_t ypos, size_t xpos, size_t starty, bool erase);
 
 
 /*
@@ -169,17 +747,18 @@ void print_lastcom(int com, size_t n_cols);
 /*
     Prints the current geometry status of the game board (note: refresh() must still be called)
     toroidal: true: board is toroidal | false: board is flat/walled
+    upd_per_frame: # of updates per displayed frame (0: full speed)
+    pace: pacer of the update thread, for the achieved rate (NULL: input phase, nothing achieved yet)
     n_cols: height of the game board, used to calculate offset
 */
-void print_gameParams(bool toroidal, size_t upd_rate, size_t maxiters, size_t n_rows);
+void print_gameParams(bool toroidal, size_t upd_rate, size_t upd_per_frame, const struct _pacer* pace, size_t maxiters, size_t n_rows);
 
 
 /*
-    Checks if a tile will have life on the next cycle based on current life status & # of living neighbours
-    current: current life status of the tile
-    nbrs: # of living neighbours
-    return: true: will have life | false: won't have life
+    Prints the performance counters on the two lines below the game parameters (note: refresh() must still be called)
+    P: counters of the game
+    n_rows: height of the game board, used to calculate offset
 */
-static inline
-bool test_life(bool current, size_t nbrs);
+void print_perfStats(const struct _perf_counters* P, size_t n_rows);
 
+#endif
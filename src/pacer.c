@@ -0,0 +1,73 @@
+/*
+ -------------------------------------
+ File:    pacer.c
+ Project: conway-game-of-life
+ Deadline-based pacing of the update and display loops
+ -------------------------------------
+ Author:  Akshath Wikramanayake
+ Email:   akshath.wikramanayake@gmail.com
+ Version  0.0.1
+ -------------------------------------
+ */
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <errno.h>
+#include <time.h>
+
+#include "life_functions.h"
+#include "pacer.h"
+
+
+void pacer_start(pacer* P, size_t rate) {
+    P->rate = rate ? rate : 1;
+    P->period_ns = 1000000000 / P->rate;
+    P->next_ns = clock_ns();
+    atomic_store_explicit(&P->start_ns, P->next_ns, memory_order_relaxed);
+    atomic_store_explicit(&P->ticks, 0, memory_order_relaxed);
+    atomic_store_explicit(&P->overruns, 0, memory_order_relaxed);
+    atomic_store_explicit(&P->late_ns, 0, memory_order_relaxed);
+}
+
+
+/*
+    Sleeps until an absolute clock_ns time (CLOCK_MONOTONIC), resuming after signals
+*/
+static
+void sleep_until(uint64_t ns) {
+    struct timespec until = { .tv_sec = ns / 1000000000, .tv_nsec = ns % 1000000000 };
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &until, NULL) == EINTR) {
+    }
+}
+
+
+uint64_t pacer_wait(pacer* P) {
+    uint64_t now = clock_ns();
+    P->next_ns += P->period_ns;
+    if (now >= P->next_ns) {                                        // the work took longer than a period
+        atomic_fetch_add_explicit(&P->overruns, 1, memory_order_relaxed);
+        atomic_fetch_add_explicit(&P->ticks, 1, memory_order_relaxed);
+        P->next_ns = now;                                           // late ticks are not made up for
+        return 0;
+    }
+    sleep_until(P->next_ns);
+    uint64_t woke = clock_ns();
+    atomic_fetch_add_explicit(&P->late_ns, woke > P->next_ns ? woke - P->next_ns : 0, memory_order_relaxed);
+    atomic_fetch_add_explicit(&P->ticks, 1, memory_order_relaxed);  // counted once the period is over
+    return woke - now;
+}
+
+
+double pacer_rate(const pacer* P) {
+    uint64_t elapsed = clock_ns() - atomic_load_explicit(&P->start_ns, memory_order_relaxed);
+    return elapsed ? atomic_load_explicit(&P->ticks, memory_order_relaxed) * 1e9 / elapsed : 0.0;
+}
+
+
+double pacer_jitter_ms(const pacer* P) {
+    size_t overruns = atomic_load_explicit(&P->overruns, memory_order_relaxed);
+    size_t ticks = atomic_load_explicit(&P->ticks, memory_order_relaxed);
+    return (ticks > overruns) ? atomic_load_explicit(&P->late_ns, memory_order_relaxed) * 1e-6 / (ticks - overruns) : 0.0;
+}
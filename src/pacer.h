@@ -0,0 +1,69 @@
+/*
+ -------------------------------------
+ File:    pacer.h
+ Project: conway-game-of-life
+ Header for the deadline-based pacing of the update and display loops
+ -------------------------------------
+ Author:  Akshath Wikramanayake
+ Email:   akshath.wikramanayake@gmail.com
+ Version  0.0.1
+ -------------------------------------
+ */
+
+#ifndef PACER_H
+#define PACER_H
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+
+#include "life_functions.h"
+
+#define DISPLAY_RATE 120                // frames per second at which the display threads look for something to draw
+
+
+/*
+    Paces a loop at a fixed rate with absolute deadlines on the monotonic clock: tick n is due at
+    start + n * period whatever the work between ticks took, so the rate does not drift below the requested
+    one as the work grows. A tick whose deadline has already passed is an overrun; the schedule then restarts
+    from the current time rather than bursting to catch up. The counters are written by the paced thread and
+    read by the display (relaxed, for the status line only).
+*/
+typedef struct _pacer {
+    size_t rate;                        // requested ticks per second
+    uint64_t period_ns;                 // time between deadlines
+    uint64_t next_ns;                   // deadline of the next tick (clock_ns time)
+    atomic_uint_least64_t start_ns;     // time pacer_start was called
+    atomic_size_t ticks;                // # of ticks since pacer_start
+    atomic_size_t overruns;             // # of ticks that were already late when the work was done
+    atomic_uint_least64_t late_ns;      // total time woken up after a deadline (jitter of the sleeps)
+} pacer;
+
+
+/*
+    (Re)starts pacing at a new rate from now and resets the counters
+    rate: ticks per second (at least 1)
+*/
+void pacer_start(pacer*, size_t rate);
+
+
+/*
+    Ends a tick: sleeps until the deadline of the next one (immediately returns on an overrun)
+    returns: time slept in ns
+*/
+uint64_t pacer_wait(pacer*);
+
+
+/*
+    Ticks per second achieved since pacer_start
+*/
+double pacer_rate(const pacer*);
+
+
+/*
+    Average lateness of the wake-ups in ms (0 before the first sleep)
+*/
+double pacer_jitter_ms(const pacer*);
+
+#endif
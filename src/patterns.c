@@ -0,0 +1,325 @@
+/*
+ -------------------------------------
+ File:    patterns.c
+ Project: conway-game-of-life
+ Streaming loaders for RLE, Life 1.06 and plaintext pattern files
+ -------------------------------------
+ Author:  Akshath Wikramanayake
+ Email:   akshath.wikramanayake@gmail.com
+ Version  0.0.1
+ -------------------------------------
+ */
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include <ctype.h>
+
+#include "life_functions.h"
+#include "patterns.h"
+
+
+/*
+    Buffered reader: the file is read PATTERN_BUFFER bytes at a time
+*/
+typedef struct _reader {
+    FILE* f;
+    size_t pos, len;            // position of the next character / # of characters in buf
+    size_t line;                // current line (1-indexed)
+    char buf[PATTERN_BUFFER];
+} reader;
+
+
+static inline
+int peek_char(reader* r) {
+    if (r->pos == r->len) {
+        r->len = fread(r->buf, 1, PATTERN_BUFFER, r->f);
+        r->pos = 0;
+        if (r->len == 0) {
+            return EOF;
+        }
+    }
+    return (unsigned char)r->buf[r->pos];
+}
+
+
+static inline
+int next_char(reader* r) {
+    int c = peek_char(r);
+    if (c != EOF) {
+        r->pos++;
+        r->line += (c == '\n');
+    }
+    return c;
+}
+
+
+/*
+    Skips the rest of the current line (including the newline)
+*/
+static
+void skip_line(reader* r) {
+    int c;
+    while ((c = next_char(r)) != EOF && c != '\n') {
+    }
+}
+
+
+/*
+    Reads the rest of the current line into s (truncated to n - 1 characters, the newline is dropped)
+*/
+static
+void read_line(reader* r, char* s, size_t n) {
+    size_t k = 0;
+    int c;
+    while ((c = next_char(r)) != EOF && c != '\n') {
+        if (k + 1 < n && c != '\r') {
+            s[k++] = c;
+        }
+    }
+    s[k] = 0;
+}
+
+
+/*
+    Reads an optionally signed decimal integer, skipping leading spaces and tabs
+    returns: true if a number was read
+*/
+static
+bool read_int(reader* r, int64_t* v) {
+    int c;
+    while ((c = peek_char(r)) == ' ' || c == '\t') {
+        next_char(r);
+    }
+    bool neg = (c == '-');
+    if (neg) {
+        next_char(r);
+    }
+    if (!isdigit(peek_char(r))) {
+        return false;
+    }
+    int64_t x = 0;
+    while (isdigit(c = peek_char(r))) {
+        x = 10 * x + (c - '0');
+        next_char(r);
+    }
+    *v = neg ? -x : x;
+    return true;
+}
+
+
+/*
+    Sets n living cells starting at cell (y, x), clipping them to the board
+*/
+static
+void set_run(board* B, int64_t y, int64_t x, int64_t n, pattern_info* info) {
+    info->cells += n;
+    int64_t x1 = x + n;
+    if (y < 0 || y >= (int64_t)B->n_rows || x1 <= 0 || x >= (int64_t)B->n_cols) {
+        info->clipped += n;
+        return;
+    }
+    if (x < 0) x = 0;
+    if (x1 > (int64_t)B->n_cols) x1 = B->n_cols;
+    info->clipped += n - (x1 - x);
+
+    uint64_t* row = board_row(B, y + 1);
+    while (x < x1) {                                                // whole words at a time
+        size_t w = (x >> 6) + 1;
+        int lo = x & 63;
+        int hi = (x1 - (x & ~63) < 64) ? (x1 & 63) : 64;            // end of the run within this word
+        uint64_t mask = (hi == 64 ? ~(uint64_t)0 : ((uint64_t)1 << hi) - 1) & (~(uint64_t)0 << lo);
+        row[w] |= mask;
+        x = (x & ~63) + hi;
+    }
+}
+
+
+static
+bool parse_rle(reader* r, board* B, int64_t y0, int64_t x0, pattern_info* info) {
+    int64_t y = 0, x = 0, n = 0;
+    int c;
+    while ((c = next_char(r)) != EOF) {
+        if (isdigit(c)) {
+            n = 10 * n + (c - '0');
+            continue;
+        }
+        if (isspace(c)) {                                           // lines may be wrapped anywhere
+            continue;
+        }
+        int64_t count = n ? n : 1;
+        n = 0;
+        switch (c) {
+            case 'b':
+            case '.': x += count; break;
+            case '$': y += count; x = 0; break;
+            case '!': return true;
+            case '#': skip_line(r); break;
+            default:
+                if (!isalpha(c)) {
+                    return false;
+                }
+                set_run(B, y0 + y, x0 + x, count, info);            // o, or any state > 0 of a multi-state pattern
+                x += count;
+                break;
+        }
+    }
+    return true;                                                    // a missing '!' is tolerated
+}
+
+
+static
+bool parse_cells(reader* r, board* B, int64_t y0, int64_t x0, pattern_info* info) {
+    int64_t y = 0, x = 0;
+    int64_t run = 0;                                                // # of living cells ending at x
+    int c;
+    while ((c = next_char(r)) != EOF) {
+        bool alive = (c == 'O' || c == '*');
+        if (!alive && run) {
+            set_run(B, y0 + y, x0 + x - run, run, info);
+            run = 0;
+        }
+        if (alive) {
+            run++;
+            x++;
+        } else if (c == '.') {
+            x++;
+        } else if (c == '\n') {
+            y++;
+            x = 0;
+        } else if (c == '!' && x == 0) {
+            skip_line(r);
+        } else if (c != '\r' && c != ' ' && c != '\t') {
+            return false;
+        }
+    }
+    if (run) {
+        set_run(B, y0 + y, x0 + x - run, run, info);
+    }
+    return true;
+}
+
+
+/*
+    Reads the cells of a Life 1.06 file. On the first pass (B == NULL) only the top-left corner of
+    the bounding box is computed so the second pass can place it at (y0, x0).
+*/
+static
+bool parse_life106(reader* r, board* B, int64_t y0, int64_t x0, int64_t* min_y, int64_t* min_x, pattern_info* info) {
+    int c;
+    while ((c = peek_char(r)) != EOF) {
+        if (c == '#' || c == '\n' || c == '\r') {
+            skip_line(r);
+            continue;
+        }
+        int64_t x, y;
+        if (!read_int(r, &x) || !read_int(r, &y)) {
+            return false;
+        }
+        if (B) {
+            set_run(B, y0 + y - *min_y, x0 + x - *min_x, 1, info);
+        } else {
+            if (y < *min_y) *min_y = y;
+            if (x < *min_x) *min_x = x;
+        }
+        skip_line(r);
+    }
+    return true;
+}
+
+
+/*
+    Detects the format from the first non-comment line, skipping the header lines. For RLE files the
+    "x = ..." header line is consumed and its rule is stored in info.
+*/
+static
+size_t detect_format(reader* r, const char* path, pattern_info* info) {
+    size_t format = PATTERN_UNKNOWN;
+    char line[256];
+    int c;
+    while ((c = peek_char(r)) != EOF) {
+        if (c == '#') {
+            read_line(r, line, sizeof(line));
+            if (!strncmp(line, "#Life 1.06", 10)) {
+                format = PATTERN_LIFE106;
+            }
+        } else if (c == '!') {
+            skip_line(r);
+            format = PATTERN_CELLS;
+        } else if (isspace(c)) {
+            next_char(r);
+        } else if (c == 'x' && format == PATTERN_UNKNOWN) {
+            read_line(r, line, sizeof(line));
+            char* rule = strstr(line, "rule");
+            if (rule && (rule = strchr(rule, '='))) {
+                rule += strspn(rule + 1, " \t") + 1;
+                size_t len = strcspn(rule, " \t,");
+                if (len >= sizeof(info->rule)) len = sizeof(info->rule) - 1;
+                memcpy(info->rule, rule, len);
+                info->rule[len] = 0;
+            }
+            return PATTERN_RLE;
+        } else {
+            break;
+        }
+    }
+    if (format == PATTERN_UNKNOWN) {                                // headerless file: go by the extension
+        const char* ext = strrchr(path, '.');
+        if (ext && !strcmp(ext, ".rle")) format = PATTERN_RLE;
+        else if (ext && (!strcmp(ext, ".lif") || !strcmp(ext, ".life"))) format = PATTERN_LIFE106;
+        else if (c == '.' || c == 'O' || c == '*') format = PATTERN_CELLS;
+    }
+    return format;
+}
+
+
+bool load_pattern(board* B, const char* path, int64_t y0, int64_t x0, pattern_info* info) {
+    pattern_info dummy;
+    if (!info) {
+        info = &dummy;
+    }
+    memset(info, 0, sizeof(*info));
+
+    FILE* f = fopen(path, "rb");
+    if (!f) {
+        return false;
+    }
+    reader* r = game_malloc(sizeof(reader));                        // one buffer for the whole file
+    r->f = f;
+    r->pos = r->len = 0;
+    r->line = 1;
+
+    bool ok = false;
+    info->format = detect_format(r, path, info);
+    switch (info->format) {
+        case PATTERN_RLE: ok = parse_rle(r, B, y0, x0, info); break;
+        case PATTERN_CELLS: ok = parse_cells(r, B, y0, x0, info); break;
+        case PATTERN_LIFE106: {
+            int64_t min_y = INT64_MAX, min_x = INT64_MAX;
+            ok = parse_life106(r, NULL, y0, x0, &min_y, &min_x, info);
+            if (ok) {                                               // second pass: place the bounding box at (y0, x0)
+                rewind(f);
+                r->pos = r->len = 0;
+                r->line = 1;
+                ok = parse_life106(r, B, y0, x0, &min_y, &min_x, info);
+            }
+            break;
+        }
+    }
+    info->line = r->line;
+    fclose(f);
+    free(r);
+    return ok;
+}
+
+
+const char* pattern_format_name(size_t format) {
+    switch (format) {
+        case PATTERN_RLE: return "RLE";
+        case PATTERN_LIFE106: return "Life 1.06";
+        case PATTERN_CELLS: return "plaintext";
+        default: return "unknown";
+    }
+}
@@ -0,0 +1,61 @@
+/*
+ -------------------------------------
+ File:    patterns.h
+ Project: conway-game-of-life
+ Header for the pattern file loaders (RLE, Life 1.06, plaintext .cells)
+ -------------------------------------
+ Author:  Akshath Wikramanayake
+ Email:   akshath.wikramanayake@gmail.com
+ Version  0.0.1
+ -------------------------------------
+ */
+
+#ifndef PATTERNS_H
+#define PATTERNS_H
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "life_functions.h"
+
+#define PATTERN_BUFFER 65536            // bytes read from the file at a time
+
+
+enum pattern_enum {
+    PATTERN_UNKNOWN = 0,
+    PATTERN_RLE,                // run-length encoded: header "x = w, y = h, rule = ...", runs of b/o, $ ends a row, ! ends the pattern
+    PATTERN_LIFE106,            // "#Life 1.06" header followed by one "x y" pair per living cell
+    PATTERN_CELLS,              // plaintext: '!' comment lines, then one line per row of '.' (dead) and 'O' (alive)
+};
+
+
+typedef struct _pattern_info {
+    size_t format;              // detected format (see pattern_enum)
+    size_t cells;               // # of living cells in the file
+    size_t clipped;             // # of living cells that fell outside the board
+    size_t line;                // line of the file where parsing stopped (the offending line on errors)
+    char rule[64];              // rule given in the RLE header ("" if none)
+} pattern_info;
+
+
+/*
+    Reads a pattern file and sets its living cells on the board. The file is read in blocks of
+    PATTERN_BUFFER bytes and runs of living cells are written straight into the board words, so
+    the time and memory needed do not depend on the size of the pattern.
+    The format is detected from the contents (falling back to the file extension).
+    B: board that receives the pattern (cells that are already alive are kept)
+    path: pattern file
+    y0, x0: board cell that the top-left cell of the pattern is placed at (may be negative: the pattern is clipped)
+    info: filled in with the format and cell counts (may be NULL)
+    returns: true on success | false if the file could not be read or is not a valid pattern (see info->line)
+*/
+bool load_pattern(board* B, const char* path, int64_t y0, int64_t x0, pattern_info* info);
+
+
+/*
+    returns: name of a pattern format (see pattern_enum)
+*/
+const char* pattern_format_name(size_t format);
+
+#endif
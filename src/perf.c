@@ -0,0 +1,142 @@
+/*
+ -------------------------------------
+ File:    perf.c
+ Project: conway-game-of-life
+ Performance counters of the game and their periodic dump
+ -------------------------------------
+ Author:  Akshath Wikramanayake
+ Email:   akshath.wikramanayake@gmail.com
+ Version  0.0.1
+ -------------------------------------
+ */
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <time.h>
+
+#include "life_functions.h"
+#include "perf.h"
+
+
+perf_counters* create_perf(size_t cells) {
+    perf_counters* P = game_calloc(1, sizeof(perf_counters));      // all counters start at 0
+    P->cells = cells;
+    perf_start(P);
+    return P;
+}
+
+
+void perf_start(perf_counters* P) {
+    atomic_store(&P->alloc_base, game_alloc_count());
+    atomic_store(&P->start_ns, clock_ns());
+}
+
+
+void perf_lock(perf_counters* P, pthread_mutex_t* mtx) {
+    if (!P) {
+        pthread_mutex_lock(mtx);
+        return;
+    }
+    if (pthread_mutex_trylock(mtx) == 0) {                          // uncontended: no clock reads
+        return;
+    }
+    uint64_t t0 = clock_ns();
+    pthread_mutex_lock(mtx);
+    perf_add(&P->wait_ns, clock_ns() - t0);
+    perf_count(&P->waits, 1);
+}
+
+
+int perf_cond_wait(perf_counters* P, pthread_cond_t* cnd, pthread_mutex_t* mtx) {
+    if (!P) {
+        return timed_cond_wait(cnd, mtx);
+    }
+    uint64_t t0 = clock_ns();
+    int res = timed_cond_wait(cnd, mtx);
+    perf_add(&P->wait_ns, clock_ns() - t0);
+    perf_count(&P->waits, 1);
+    return res;
+}
+
+
+double perf_ns_per_gen(const perf_counters* P) {
+    size_t gens = atomic_load_explicit(&P->generations, memory_order_relaxed);
+    return gens ? (double)atomic_load_explicit(&P->update_ns, memory_order_relaxed) / gens : 0.0;
+}
+
+
+/*
+    Writes one CSV line with the current counters
+*/
+static
+void write_line(perf_logger* L) {
+    perf_counters* P = L->P;
+    size_t gens = atomic_load(&P->generations);
+    uint64_t update_ns = atomic_load(&P->update_ns);
+    fprintf(L->file, "%.3f,%zu,%zu,%llu,%.1f,%.4g,%zu,%zu,%llu,%zu,%llu,%llu,%zu\n",
+            (clock_ns() - atomic_load(&P->start_ns)) * 1e-9, atomic_load(&P->updates), gens, (unsigned long long)update_ns,
+            gens ? (double)update_ns / gens : 0.0, update_ns ? (double)P->cells * gens * 1e9 / update_ns : 0.0,
+            atomic_load(&P->published), atomic_load(&P->frames), (unsigned long long)atomic_load(&P->draw_ns),
+            atomic_load(&P->waits), (unsigned long long)atomic_load(&P->wait_ns),
+            (unsigned long long)atomic_load(&P->sleep_ns), game_alloc_count() - atomic_load(&P->alloc_base));
+    fflush(L->file);                                                // readable while the game is still running
+}
+
+
+static
+void* logger_thread(void* Lv) {
+    perf_logger* L = Lv;
+    pthread_mutex_lock(&L->mtx);
+    while (!L->quit) {
+        struct timespec until;
+        timespec_get(&until, TIME_UTC);
+        until.tv_sec += L->interval_ms / 1000;
+        until.tv_nsec += (L->interval_ms % 1000) * 1000000;
+        if (until.tv_nsec >= 1000000000) {
+            until.tv_sec++;
+            until.tv_nsec -= 1000000000;
+        }
+        while (!L->quit && pthread_cond_timedwait(&L->cond, &L->mtx, &until) == 0) {
+        }                                                           // woken early without quit: keep waiting
+        pthread_mutex_unlock(&L->mtx);
+        write_line(L);
+        pthread_mutex_lock(&L->mtx);
+    }
+    pthread_mutex_unlock(&L->mtx);
+    return 0;
+}
+
+
+perf_logger* create_perf_logger(perf_counters* P, const char* path, size_t interval_ms) {
+    FILE* f = fopen(path, "w");
+    if (!f) {
+        return NULL;
+    }
+    fprintf(f, "time_s,updates,generations,update_ns,ns_per_gen,cells_per_s,published,frames,draw_ns,waits,wait_ns,sleep_ns,allocs\n");
+    perf_logger* L = game_malloc(sizeof(perf_logger));
+    L->P = P;
+    L->file = f;
+    L->interval_ms = interval_ms ? interval_ms : 1;
+    pthread_mutex_init(&L->mtx, 0);
+    pthread_cond_init(&L->cond, 0);
+    L->quit = false;
+    pthread_create(&L->thread, 0, logger_thread, L);
+    return L;
+}
+
+
+void destroy_perf_logger(perf_logger* L) {
+    pthread_mutex_lock(&L->mtx);
+    L->quit = true;
+    pthread_cond_broadcast(&L->cond);
+    pthread_mutex_unlock(&L->mtx);
+    pthread_join(L->thread, 0);                                     // the thread writes the last line on its way out
+    pthread_cond_destroy(&L->cond);
+    pthread_mutex_destroy(&L->mtx);
+    fclose(L->file);
+    free(L);
+}
@@ -0,0 +1,133 @@
+/*
+ -------------------------------------
+ File:    perf.h
+ Project: conway-game-of-life
+ Header for the performance counters of the game
+ -------------------------------------
+ Author:  Akshath Wikramanayake
+ Email:   akshath.wikramanayake@gmail.com
+ Version  0.0.1
+ -------------------------------------
+ */
+
+#ifndef PERF_H
+#define PERF_H
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include <stdatomic.h>
+
+#include "life_functions.h"
+
+
+/*
+    Timers and counters of the hot paths. Each counter has a single writer (the update thread, the display
+    thread or the thread holding the board mutex), so updates are relaxed atomic adds that never contend;
+    readers (status lines, perf_logger) may see counters from slightly different moments.
+*/
+typedef struct _perf_counters {
+    atomic_size_t updates;              // # of game_update calls
+    atomic_size_t generations;          // # of generations computed
+    atomic_uint_least64_t update_ns;    // time spent in game_update
+    atomic_size_t published;            // # of frames handed to the display
+    atomic_size_t frames;               // # of frames drawn
+    atomic_uint_least64_t draw_ns;      // time spent drawing frames (including refresh)
+    atomic_size_t waits;                // # of times a thread waited for the board mutex or in timed_cond_wait
+    atomic_uint_least64_t wait_ns;      // time spent in those waits
+    atomic_uint_least64_t sleep_ns;     // time spent sleeping (update rate cap, idle display)
+    atomic_size_t seeks;                // # of boards rebuilt from the history (rewinding while paused)
+    atomic_uint_least64_t seek_ns;      // time spent rebuilding them
+    atomic_size_t history_bytes;        // bytes of the records kept by the history (stored by the update thread)
+    atomic_size_t history_first;        // oldest and newest generation kept by the history
+    atomic_size_t history_last;
+
+    size_t cells;                       // # of cells per generation (board size)
+    atomic_uint_least64_t start_ns;     // clock_ns() at perf_start (restarted by the update thread, read by the others)
+    atomic_size_t alloc_base;           // game_alloc_count() at perf_start
+} perf_counters;
+
+
+/*
+    Periodic dump of the counters to a CSV file, written by its own thread
+*/
+typedef struct _perf_logger {
+    perf_counters* P;
+    FILE* file;
+    size_t interval_ms;         // time between lines
+
+    pthread_t thread;
+    pthread_mutex_t mtx;        // protects quit
+    pthread_cond_t cond;        // signalled to stop the logger early
+    bool quit;                  // set to true to make the logger write a last line and exit
+} perf_logger;
+
+
+/*
+    Allocates zeroed counters
+    cells: # of cells per generation, used for the cells/s rates
+    returns: pointer to the new counters
+*/
+perf_counters* create_perf(size_t cells);
+
+
+/*
+    Starts the clock of the rates and the allocation count (call when the game phase begins)
+*/
+void perf_start(perf_counters*);
+
+
+/*
+    Adds to a counter (relaxed: counters are only used for reporting)
+*/
+static inline
+void perf_add(atomic_uint_least64_t* counter, uint64_t value) {
+    atomic_fetch_add_explicit(counter, value, memory_order_relaxed);
+}
+
+
+/*
+    Adds to a counter of events
+*/
+static inline
+void perf_count(atomic_size_t* counter, size_t value) {
+    atomic_fetch_add_explicit(counter, value, memory_order_relaxed);
+}
+
+
+/*
+    pthread_mutex_lock that records how long the caller waited for the mutex (P may be NULL)
+*/
+void perf_lock(perf_counters* P, pthread_mutex_t* mtx);
+
+
+/*
+    timed_cond_wait that records how long the caller waited (P may be NULL)
+    returns: return value of timed_cond_wait
+*/
+int perf_cond_wait(perf_counters* P, pthread_cond_t* cnd, pthread_mutex_t* mtx);
+
+
+/*
+    Average time per generation in game_update in ns (0 before the first generation)
+*/
+double perf_ns_per_gen(const perf_counters*);
+
+
+/*
+    Opens the stats file, writes the CSV header and starts the logger thread
+    path: file that receives one line per interval
+    interval_ms: time between lines
+    returns: pointer to the new logger | NULL if the file could not be opened
+*/
+perf_logger* create_perf_logger(perf_counters* P, const char* path, size_t interval_ms);
+
+
+/*
+    Writes a last line, stops the logger thread, closes the file and deallocates the logger
+*/
+void destroy_perf_logger(perf_logger*);
+
+#endif
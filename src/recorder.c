@@ -0,0 +1,569 @@
+/*
+ -------------------------------------
+ File:    recorder.c
+ Project: conway-game-of-life
+ Background export of game frames: animated GIF, PNG sequence or delta stream
+ -------------------------------------
+ Author:  Akshath Wikramanayake
+ Email:   akshath.wikramanayake@gmail.com
+ Version  0.0.1
+ -------------------------------------
+ */
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdbool.h>
+#include <pthread.h>
+
+#include "life_functions.h"
+#include "recorder.h"
+
+
+static uint32_t crc_table[256];                                     // CRC-32 of PNG chunks, filled by create_recorder
+
+
+/*
+    Writes bytes to the output, counting them
+    returns: true on success
+*/
+static
+bool put_bytes(recorder* R, FILE* f, const void* data, size_t n) {
+    size_t done = fwrite(data, 1, n, f);
+    R->bytes += done;
+    return done == n;
+}
+
+
+/*
+    Writes an integer in little-endian byte order
+*/
+static
+bool put_le(recorder* R, FILE* f, uint64_t value, size_t n) {
+    uint8_t buf[8];
+    for (size_t k = 0; k < n; k++) {
+        buf[k] = (uint8_t)(value >> (8 * k));
+    }
+    return put_bytes(R, f, buf, n);
+}
+
+
+/*
+    Bounding box of the cells that differ between the frame and the previous one
+    returns: false if no cell differs
+*/
+static
+bool diff_box(const board* A, const board* B, size_t* top, size_t* left, size_t* bottom, size_t* right) {
+    uint64_t last_mask = last_word_mask(A);
+    size_t n_words = A->stride - 2;
+    *top = A->n_rows;
+    *left = A->n_cols;
+    *bottom = 0;
+    *right = 0;
+    for (size_t i = 1; i < A->n_rows + 1; i++) {
+        const uint64_t* a = board_row(A, i);
+        const uint64_t* b = board_row(B, i);
+        for (size_t w = 1; w < n_words + 1; w++) {
+            uint64_t diff = (a[w] ^ b[w]) & ((w == n_words) ? last_mask : ~(uint64_t)0);
+            if (!diff) {
+                continue;
+            }
+            size_t l = (w - 1) * 64 + __builtin_ctzll(diff);
+            size_t r = (w - 1) * 64 + 63 - __builtin_clzll(diff);
+            if (i - 1 < *top) *top = i - 1;
+            *bottom = i - 1;
+            if (l < *left) *left = l;
+            if (r > *right) *right = r;
+        }
+    }
+    return *top < A->n_rows;
+}
+
+
+/*
+    Appends the low byte of the pending bits to the sub-block, writing it out when it is full
+*/
+static
+void lzw_byte(recorder* R, lzw_encoder* Z) {
+    Z->block[Z->fill++] = (uint8_t)Z->bits;
+    Z->bits >>= 8;
+    Z->n_bits = (Z->n_bits > 8) ? Z->n_bits - 8 : 0;
+    if (Z->fill == sizeof(Z->block)) {
+        uint8_t len = sizeof(Z->block);
+        put_bytes(R, Z->file, &len, 1);
+        put_bytes(R, Z->file, Z->block, Z->fill);
+        Z->fill = 0;
+    }
+}
+
+
+/*
+    Appends a code to the LZW output (LSB first)
+*/
+static
+void lzw_put(recorder* R, lzw_encoder* Z, size_t code) {
+    Z->bits |= (uint32_t)code << Z->n_bits;
+    Z->n_bits += Z->size;
+    while (Z->n_bits >= 8) {
+        lzw_byte(R, Z);
+    }
+}
+
+
+/*
+    Empties the dictionary (2 colours: minimum code size 2, clear code 4, end code 5)
+*/
+static
+void lzw_reset(lzw_encoder* Z) {
+    memset(Z->keys, 0xFF, sizeof(Z->keys));
+    Z->size = 3;
+    Z->next = 6;
+}
+
+
+static
+void lzw_start(recorder* R, lzw_encoder* Z) {
+    Z->file = R->file;
+    Z->fill = 0;
+    Z->bits = 0;
+    Z->n_bits = 0;
+    Z->prefix = -1;
+    uint8_t min_size = 2;
+    put_bytes(R, Z->file, &min_size, 1);
+    lzw_reset(Z);
+    lzw_put(R, Z, 4);                                               // clear code
+}
+
+
+/*
+    Adds one pixel: extends the matched string, or emits it and adds the extended string to the dictionary
+*/
+static inline
+void lzw_pixel(recorder* R, lzw_encoder* Z, uint8_t pixel) {
+    if (Z->prefix < 0) {
+        Z->prefix = pixel;
+        return;
+    }
+    int32_t key = (int32_t)(Z->prefix << 8) | pixel;
+    size_t h = ((uint32_t)key * 2654435761u) >> 19;                 // 13 bits: LZW_HASH slots
+    while (Z->keys[h] >= 0 && Z->keys[h] != key) {
+        h = (h + 1) & (LZW_HASH - 1);
+    }
+    if (Z->keys[h] == key) {
+        Z->prefix = Z->codes[h];
+        return;
+    }
+    lzw_put(R, Z, Z->prefix);
+    if (Z->next < 4096) {
+        if (Z->next == ((size_t)1 << Z->size)) {                    // the decoder widens its codes at the same point
+            Z->size++;
+        }
+        Z->keys[h] = key;
+        Z->codes[h] = (uint16_t)Z->next++;
+    } else {                                                        // dictionary full: start over
+        lzw_put(R, Z, 4);
+        lzw_reset(Z);
+    }
+    Z->prefix = pixel;
+}
+
+
+static
+void lzw_end(recorder* R, lzw_encoder* Z) {
+    if (Z->prefix >= 0) {
+        lzw_put(R, Z, Z->prefix);
+    }
+    lzw_put(R, Z, 5);                                               // end code
+    if (Z->n_bits) {                                                // the last byte is padded with 0s
+        lzw_byte(R, Z);
+    }
+    if (Z->fill) {
+        uint8_t len = (uint8_t)Z->fill;
+        put_bytes(R, Z->file, &len, 1);
+        put_bytes(R, Z->file, Z->block, Z->fill);
+    }
+    uint8_t end = 0;
+    put_bytes(R, Z->file, &end, 1);
+}
+
+
+/*
+    Writes one GIF frame: the whole board for the first frame, then only the rectangle of cells that changed
+    (earlier frames are not disposed, so the rest of the image stays as it was)
+*/
+static
+bool gif_frame(recorder* R, const board* B) {
+    size_t top = 0, left = 0;
+    size_t bottom = B->n_rows - 1, right = B->n_cols - 1;
+    if (!R->first && !diff_box(R->prev, B, &top, &left, &bottom, &right)) {
+        bottom = top = 0;                                           // unchanged: 1 cell keeps the timing
+        right = left = 0;
+    }
+    uint8_t gce[8] = { 0x21, 0xF9, 4, 1 << 2, RECORD_GIF_DELAY & 0xFF, RECORD_GIF_DELAY >> 8, 0, 0 };
+    uint8_t sep = 0x2C;
+    uint8_t packed = 0;                                             // no local colour table, not interlaced
+    bool ok = put_bytes(R, R->file, gce, sizeof(gce))
+           && put_bytes(R, R->file, &sep, 1)
+           && put_le(R, R->file, left, 2) && put_le(R, R->file, top, 2)
+           && put_le(R, R->file, right - left + 1, 2) && put_le(R, R->file, bottom - top + 1, 2)
+           && put_bytes(R, R->file, &packed, 1);
+    lzw_encoder* Z = R->lzw;
+    lzw_start(R, Z);
+    for (size_t i = top; i < bottom + 1; i++) {
+        const uint64_t* row = board_row(B, i + 1);
+        for (size_t j = left; j < right + 1; j++) {
+            lzw_pixel(R, Z, (row[(j >> 6) + 1] >> (j & 63)) & 1);
+        }
+    }
+    lzw_end(R, Z);
+    return ok && !ferror(R->file);
+}
+
+
+/*
+    Writes the GIF header: logical screen of 1 pixel per cell, 2-colour palette (dead black, alive white)
+    and the NETSCAPE2.0 extension that loops the animation forever
+*/
+static
+bool gif_begin(recorder* R, size_t n_rows, size_t n_cols) {
+    static const uint8_t palette[6] = { 0, 0, 0, 255, 255, 255 };
+    static const uint8_t loop[19] = { 0x21, 0xFF, 11, 'N', 'E', 'T', 'S', 'C', 'A', 'P', 'E', '2', '.', '0', 3, 1, 0, 0, 0 };
+    uint8_t screen[3] = { 0x80, 0, 0 };                             // global colour table of 2 entries
+    return put_bytes(R, R->file, "GIF89a", 6)
+        && put_le(R, R->file, n_cols, 2) && put_le(R, R->file, n_rows, 2)
+        && put_bytes(R, R->file, screen, 3)
+        && put_bytes(R, R->file, palette, sizeof(palette))
+        && put_bytes(R, R->file, loop, sizeof(loop));
+}
+
+
+/*
+    Running CRC-32 of a PNG chunk
+*/
+static
+uint32_t crc_add(uint32_t crc, const uint8_t* data, size_t n) {
+    for (size_t k = 0; k < n; k++) {
+        crc = crc_table[(crc ^ data[k]) & 0xFF] ^ (crc >> 8);
+    }
+    return crc;
+}
+
+
+/*
+    Writes bytes that are part of a PNG chunk
+*/
+static
+bool png_put(recorder* R, FILE* f, uint32_t* crc, const uint8_t* data, size_t n) {
+    *crc = crc_add(*crc, data, n);
+    return put_bytes(R, f, data, n);
+}
+
+
+/*
+    Writes a 32-bit big-endian integer that is part of a PNG chunk
+*/
+static
+bool png_put32(recorder* R, FILE* f, uint32_t* crc, uint32_t value) {
+    uint8_t buf[4] = { value >> 24, value >> 16, value >> 8, value };
+    return crc ? png_put(R, f, crc, buf, 4) : put_bytes(R, f, buf, 4);
+}
+
+
+/*
+    Writes the frame to its own 1-bit greyscale PNG (alive white). The image data is stored in uncompressed
+    deflate blocks, so no compression library is needed and encoding is a copy of the bit-packed rows.
+*/
+static
+bool png_frame(recorder* R, const board* B, size_t generation) {
+    size_t len = strlen(R->path) - 4;                               // the path ends in ".png"
+    char* name = game_malloc(len + 32);
+    snprintf(name, len + 32, "%.*s_%06zu.png", (int)len, R->path, generation);
+    FILE* f = fopen(name, "wb");
+    free(name);
+    if (!f) {
+        return false;
+    }
+
+    size_t width = B->n_cols;
+    size_t line = 1 + (width + 7) / 8;                              // filter byte + packed pixels
+    uint64_t raw = (uint64_t)line * B->n_rows;
+    uint64_t n_blocks = (raw + 65534) / 65535;
+    uint64_t idat = 2 + raw + 5 * n_blocks + 4;                     // zlib header, stored blocks, Adler-32
+    static const uint8_t signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+    uint8_t ihdr[5] = { 1, 0, 0, 0, 0 };                            // bit depth 1, greyscale, deflate, no filter, no interlace
+    uint32_t crc = 0xFFFFFFFFu;
+    bool ok = put_bytes(R, f, signature, 8)
+           && png_put32(R, f, NULL, 13)
+           && png_put(R, f, &crc, (const uint8_t*)"IHDR", 4)
+           && png_put32(R, f, &crc, width) && png_put32(R, f, &crc, B->n_rows)
+           && png_put(R, f, &crc, ihdr, 5)
+           && png_put32(R, f, NULL, ~crc);
+
+    uint8_t zlib[2] = { 0x78, 0x01 };
+    crc = 0xFFFFFFFFu;
+    ok = ok && png_put32(R, f, NULL, (uint32_t)idat)
+            && png_put(R, f, &crc, (const uint8_t*)"IDAT", 4)
+            && png_put(R, f, &crc, zlib, 2);
+    uint32_t a = 1, b = 0;                                          // Adler-32 of the raw image data
+    uint64_t left = raw;                                            // bytes not yet written
+    size_t in_block = 0;                                            // bytes left in the current stored block
+    for (size_t i = 1; i < B->n_rows + 1 && ok; i++) {
+        const uint64_t* row = board_row(B, i);
+        uint8_t* px = R->line;
+        px[0] = 0;                                                  // filter: none
+        for (size_t j = 0; j < width; j += 8) {                     // PNG packs the leftmost pixel into the high bit
+            uint8_t bits = (uint8_t)(row[(j >> 6) + 1] >> (j & 63));
+            bits = (uint8_t)(((bits * 0x0802u & 0x22110u) | (bits * 0x8020u & 0x88440u)) * 0x10101u >> 16);    // reverse
+            if (j + 8 > width) {
+                bits &= (uint8_t)(0xFF << (j + 8 - width));
+            }
+            px[1 + j / 8] = bits;
+        }
+        for (size_t k = 0; k < line; k++) {
+            a = (a + px[k]) % 65521;
+            b = (b + a) % 65521;
+        }
+        for (size_t k = 0; k < line && ok; ) {
+            if (!in_block) {                                        // header of the next stored block
+                size_t n = left < 65535 ? left : 65535;
+                uint8_t head[5] = { left == n, n & 0xFF, n >> 8, ~n & 0xFF, (~n >> 8) & 0xFF };
+                ok = png_put(R, f, &crc, head, 5);
+                in_block = n;
+            }
+            size_t n = (line - k < in_block) ? line - k : in_block;
+            ok = ok && png_put(R, f, &crc, px + k, n);
+            k += n;
+            in_block -= n;
+            left -= n;
+        }
+    }
+    ok = ok && png_put32(R, f, &crc, (b << 16) | a)
+            && png_put32(R, f, NULL, ~crc);
+    crc = 0xFFFFFFFFu;
+    ok = ok && png_put32(R, f, NULL, 0)
+            && png_put(R, f, &crc, (const uint8_t*)"IEND", 4)
+            && png_put32(R, f, NULL, ~crc);
+    ok = (fclose(f) == 0) && ok;
+    return ok;
+}
+
+
+/*
+    Appends a LEB128 varint
+*/
+static
+bool put_varint(recorder* R, uint64_t value) {
+    uint8_t buf[10];
+    size_t n = 0;
+    do {
+        buf[n++] = (uint8_t)((value & 0x7F) | (value > 0x7F ? 0x80 : 0));
+        value >>= 7;
+    } while (value);
+    return put_bytes(R, R->file, buf, n);
+}
+
+
+/*
+    Appends one frame to the delta stream: the words that changed since the previous frame
+*/
+static
+bool delta_frame(recorder* R, const board* B, size_t generation) {
+    uint64_t last_mask = last_word_mask(B);
+    size_t n_words = B->stride - 2;
+    uint64_t changed = 0;
+    for (size_t i = 1; i < B->n_rows + 1; i++) {                    // count first: the record starts with the count
+        const uint64_t* a = board_row(R->prev, i);
+        const uint64_t* b = board_row(B, i);
+        for (size_t w = 1; w < n_words + 1; w++) {
+            changed += ((a[w] ^ b[w]) & ((w == n_words) ? last_mask : ~(uint64_t)0)) != 0;
+        }
+    }
+    bool ok = put_le(R, R->file, generation, 8) && put_le(R, R->file, changed, 8);
+    uint64_t skipped = 0;
+    for (size_t i = 1; i < B->n_rows + 1 && ok; i++) {
+        const uint64_t* a = board_row(R->prev, i);
+        const uint64_t* b = board_row(B, i);
+        for (size_t w = 1; w < n_words + 1; w++) {
+            uint64_t diff = (a[w] ^ b[w]) & ((w == n_words) ? last_mask : ~(uint64_t)0);
+            if (!diff) {
+                skipped++;
+                continue;
+            }
+            ok = ok && put_varint(R, skipped) && put_le(R, R->file, diff, 8);
+            skipped = 0;
+        }
+    }
+    return ok;
+}
+
+
+/*
+    Encodes and writes one queued frame, then remembers it as the previous frame
+*/
+static
+void write_frame(recorder* R, const board* B, size_t generation) {
+    uint64_t t0 = clock_ns();
+    bool ok;
+    if (R->format == RECORD_GIF) {
+        ok = gif_frame(R, B);
+    } else if (R->format == RECORD_PNG) {
+        ok = png_frame(R, B, generation);
+    } else {
+        ok = delta_frame(R, B, generation);
+    }
+    if (R->format != RECORD_PNG) {
+        board_copy(R->prev, B);
+    }
+    R->first = false;
+    R->failed += !ok;
+    R->encode_ns += clock_ns() - t0;
+}
+
+
+static
+void* encoder_thread(void* Rv) {
+    recorder* R = Rv;
+    pthread_mutex_lock(&R->mtx);
+    while (true) {
+        while (R->consumed == R->produced && !R->quit) {
+            pthread_cond_wait(&R->cond, &R->mtx);
+        }
+        if (R->consumed == R->produced) {
+            break;                                                  // quit once the queue is empty
+        }
+        size_t k = R->consumed % RECORD_SLOTS;
+        pthread_mutex_unlock(&R->mtx);
+        write_frame(R, R->slots[k], R->slot_gen[k]);                // the slot is not touched by the game while queued
+        pthread_mutex_lock(&R->mtx);
+        R->consumed++;
+        pthread_cond_broadcast(&R->cond);
+    }
+    pthread_mutex_unlock(&R->mtx);
+    return 0;
+}
+
+
+recorder* create_recorder(const game_state* G, const char* path, size_t every, bool block) {
+    size_t len = strlen(path);
+    size_t format = RECORD_DELTA;
+    if (len >= 4 && !strcmp(path + len - 4, ".gif")) {
+        format = RECORD_GIF;
+    } else if (len >= 4 && !strcmp(path + len - 4, ".png")) {
+        format = RECORD_PNG;
+    }
+    if (format == RECORD_GIF && (G->n_rows > 65535 || G->n_cols > 65535)) {
+        return NULL;                                                // GIF sizes are 16-bit
+    }
+    FILE* f = NULL;
+    if (format != RECORD_PNG && !(f = fopen(path, "wb"))) {
+        return NULL;
+    }
+    for (uint32_t n = 0; n < 256; n++) {
+        uint32_t c = n;
+        for (int k = 0; k < 8; k++) {
+            c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+        }
+        crc_table[n] = c;
+    }
+
+    recorder* R = game_calloc(1, sizeof(recorder));                // counters start at 0
+    R->path = game_malloc(len + 1);
+    memcpy(R->path, path, len + 1);
+    R->format = format;
+    R->every = every ? every : 1;
+    R->block = block;
+    R->file = f;
+    R->prev = create_board(G->n_rows, G->n_cols);                   // the first delta frame is diffed against an empty board
+    R->first = true;
+    R->lzw = (format == RECORD_GIF) ? game_malloc(sizeof(lzw_encoder)) : NULL;
+    R->line = game_malloc(1 + (G->n_cols + 7) / 8);
+    for (size_t k = 0; k < RECORD_SLOTS; k++) {
+        R->slots[k] = create_board(G->n_rows, G->n_cols);
+        board_copy(R->slots[k], G->B);
+        R->slot_gen[k] = G->generation;
+        R->slot_epoch[k] = G->epoch;
+    }
+    R->queued_gen = G->generation;
+    R->queued_epoch = G->epoch;
+    pthread_mutex_init(&R->mtx, 0);
+    pthread_cond_init(&R->cond, 0);
+
+    bool ok = true;
+    if (format == RECORD_GIF) {
+        ok = gif_begin(R, G->n_rows, G->n_cols);
+    } else if (format == RECORD_DELTA) {
+        ok = put_bytes(R, f, RECORD_MAGIC, 8)
+          && put_le(R, f, RECORD_VERSION, 4) && put_le(R, f, G->toroidal, 4)
+          && put_le(R, f, G->n_rows, 8) && put_le(R, f, G->n_cols, 8);
+    }
+    R->failed += !ok;
+    R->produced = 1;                                                // slot 0 already holds the first frame
+    pthread_create(&R->thread, 0, encoder_thread, R);
+    return R;
+}
+
+
+void destroy_recorder(recorder* R) {
+    pthread_mutex_lock(&R->mtx);
+    R->quit = true;
+    pthread_cond_broadcast(&R->cond);
+    pthread_mutex_unlock(&R->mtx);
+    pthread_join(R->thread, 0);
+    pthread_cond_destroy(&R->cond);
+    pthread_mutex_destroy(&R->mtx);
+    if (R->format == RECORD_GIF) {
+        uint8_t trailer = 0x3B;
+        put_bytes(R, R->file, &trailer, 1);
+    }
+    if (R->file) {
+        fclose(R->file);
+    }
+    for (size_t k = 0; k < RECORD_SLOTS; k++) {
+        destroy_board(R->slots[k]);
+    }
+    destroy_board(R->prev);
+    free(R->lzw);
+    free(R->line);
+    free(R->path);
+    free(R);
+}
+
+
+void record_flush(recorder* R) {
+    pthread_mutex_lock(&R->mtx);
+    while (R->consumed != R->produced) {
+        pthread_cond_wait(&R->cond, &R->mtx);
+    }
+    pthread_mutex_unlock(&R->mtx);
+}
+
+
+bool record_frame(recorder* R, const game_state* G, bool wait) {
+    if (G->generation == R->queued_gen && G->epoch == R->queued_epoch) {
+        return false;
+    }
+    pthread_mutex_lock(&R->mtx);
+    if (R->produced - R->consumed == RECORD_SLOTS && !wait) {
+        R->dropped++;
+        pthread_mutex_unlock(&R->mtx);
+        return false;
+    }
+    while (R->produced - R->consumed == RECORD_SLOTS) {
+        pthread_cond_wait(&R->cond, &R->mtx);
+    }
+    size_t k = R->produced % RECORD_SLOTS;
+    pthread_mutex_unlock(&R->mtx);
+
+    board_copy_changed(R->slots[k], G, R->slot_gen[k], R->slot_epoch[k]);  // the slot is free: bring it up to date
+    R->slot_gen[k] = G->generation;
+    R->slot_epoch[k] = G->epoch;
+    R->queued_gen = G->generation;
+    R->queued_epoch = G->epoch;
+
+    pthread_mutex_lock(&R->mtx);
+    R->produced++;
+    pthread_cond_broadcast(&R->cond);
+    pthread_mutex_unlock(&R->mtx);
+    return true;
+}
@@ -0,0 +1,128 @@
+/*
+ -------------------------------------
+ File:    recorder.h
+ Project: conway-game-of-life
+ Header for the background export of game frames (animated GIF, PNG sequence or delta stream)
+ -------------------------------------
+ Author:  Akshath Wikramanayake
+ Email:   akshath.wikramanayake@gmail.com
+ Version  0.0.1
+ -------------------------------------
+ */
+
+#ifndef RECORDER_H
+#define RECORDER_H
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <pthread.h>
+
+#include "life_functions.h"
+
+#define RECORD_SLOTS 4          // # of frames queued for the encoder (one board copy each)
+#define RECORD_GIF_DELAY 5      // delay between GIF frames in 1/100 s
+#define RECORD_MAGIC "LIFEDLTA"
+#define RECORD_VERSION 1
+#define LZW_HASH 8192           // slots of the GIF encoder dictionary (power of 2, more than the 4096 codes)
+
+enum record_format_enum {
+    RECORD_DELTA = 0,           // delta stream: the words that changed since the previous frame
+    RECORD_GIF,                 // animated GIF, 1 pixel per cell
+    RECORD_PNG,                 // one 1-bit PNG per frame
+};
+
+
+/*
+    LZW encoder of GIF image data, packing codes into 255-byte sub-blocks
+*/
+typedef struct _lzw_encoder {
+    FILE* file;
+    uint8_t block[255];         // sub-block being filled
+    size_t fill;
+    uint32_t bits;              // bits not yet written, LSB first
+    size_t n_bits;
+    size_t size;                // current code size in bits
+    size_t next;                // next free code
+    long prefix;                // code of the string matched so far (-1: none)
+    int32_t keys[LZW_HASH];     // prefix << 8 | pixel of each dictionary entry (-1: empty slot)
+    uint16_t codes[LZW_HASH];
+} lzw_encoder;
+
+
+/*
+    Background frame exporter. The game thread copies the tiles that changed since a queue slot last held a
+    frame into that slot (a ring of RECORD_SLOTS board copies) and hands it over; the encoder thread diffs it
+    against the previous frame, compresses it and writes it, so neither encoding nor the disk slow the game.
+    When every slot is still queued the frame is dropped, or the game thread waits under the block policy.
+
+    Delta streams start with the header RECORD_MAGIC, uint32 version, uint32 toroidal, uint64 n_rows,
+    uint64 n_cols, followed by one record per frame: uint64 generation, uint64 # of changed words, then for
+    each changed word (in board order, word k is word k % n_words of row k / n_words, n_words = (n_cols + 63) / 64)
+    a LEB128 varint of the # of unchanged words skipped since the last changed one and the uint64 XOR of
+    the old and new word (bit b is column 64 * (k % n_words) + b). The first frame is diffed against an
+    empty board. All fields are little-endian.
+*/
+typedef struct _recorder {
+    char* path;                 // output file (PNG sequence: name.png gives name_<generation>.png)
+    size_t format;              // see record_format_enum
+    size_t every;               // # of updates between frames
+    bool block;                 // true: the game waits for a free slot | false: frames are dropped when the queue is full
+    board* slots[RECORD_SLOTS]; // queued frames, slot k % RECORD_SLOTS holds frame k
+    size_t slot_gen[RECORD_SLOTS];  // generation held by each slot
+    size_t slot_epoch[RECORD_SLOTS];    // G->epoch of each slot
+    size_t queued_gen;          // generation of the last frame handed over
+    size_t queued_epoch;        // G->epoch of the last frame handed over
+
+    FILE* file;                 // GIF or delta stream
+    board* prev;                // previous frame written (encoder thread only)
+    bool first;                 // no frame written yet
+    lzw_encoder* lzw;           // GIF only
+    uint8_t* line;              // scratch row of PNG pixels
+
+    pthread_t thread;
+    pthread_mutex_t mtx;        // protects produced, consumed and quit
+    pthread_cond_t cond;        // signalled when a frame is handed over or written
+    size_t produced;            // # of frames handed over
+    size_t consumed;            // # of frames written
+    bool quit;                  // set to true to make the encoder exit once the queue is empty
+
+    size_t dropped;             // # of frames dropped because the queue was full
+    size_t failed;              // # of frames that could not be written
+    uint64_t bytes;             // # of bytes written
+    uint64_t encode_ns;         // time the encoder spent diffing, compressing and writing
+} recorder;
+
+
+/*
+    Opens the output, starts the encoder thread and queues the current board as the first frame, so create
+    it after the board has been set up and before the game starts
+    path: output file; the format follows the name: .gif animated GIF, .png PNG sequence, anything else delta stream
+    every: # of updates between frames
+    block: back-pressure policy when the queue is full (true: wait for the encoder | false: drop the frame)
+    returns: pointer to the new recorder | NULL if the file could not be opened (or the board is too large for a GIF)
+*/
+recorder* create_recorder(const game_state* G, const char* path, size_t every, bool block);
+
+
+/*
+    Waits for the queued frames to be written, finishes the file, stops the encoder thread and deallocates it
+*/
+void destroy_recorder(recorder*);
+
+
+/*
+    Waits until every queued frame has been written
+*/
+void record_flush(recorder*);
+
+
+/*
+    Hands the current board to the encoder (nothing is done if this generation was already handed over)
+    wait: true: wait for a free slot if the queue is full | false: drop the frame instead
+    returns: true if the frame was queued
+*/
+bool record_frame(recorder*, const game_state* G, bool wait);
+
+#endif
@@ -0,0 +1,103 @@
+/*
+ -------------------------------------
+ File:    rules.c
+ Project: conway-game-of-life
+ Outer-totalistic (B/S) rules
+ -------------------------------------
+ Author:  Akshath Wikramanayake
+ Email:   akshath.wikramanayake@gmail.com
+ Version  0.0.1
+ -------------------------------------
+ */
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <ctype.h>
+
+#include "rules.h"
+
+
+void rule_init(life_rule* R, uint16_t birth, uint16_t survive) {
+    R->birth = birth & 0x1FF;
+    R->survive = survive & 0x1FF;
+    for (int n = 0; n < 9; n++) {
+        R->born[n] = ((R->birth >> n) & 1) ? ~(uint64_t)0 : 0;
+        R->kept[n] = ((R->survive >> n) & 1) ? ~(uint64_t)0 : 0;
+    }
+    bool life = (R->birth == RULE_LIFE_BIRTH && R->survive == RULE_LIFE_SURVIVE);
+    R->kernel = life ? KERNEL_LIFE : KERNEL_TABLE;
+}
+
+
+/*
+    Reads a run of neighbour counts (digits 0-8) into a mask
+    returns: pointer past the digits
+*/
+static
+const char* parse_counts(const char* s, uint16_t* mask) {
+    while (*s >= '0' && *s <= '8') {
+        *mask |= 1u << (*s - '0');
+        s++;
+    }
+    return s;
+}
+
+
+bool parse_rule(const char* s, life_rule* R) {
+    uint16_t birth = 0;
+    uint16_t survive = 0;
+    char c = toupper((unsigned char)*s);
+
+    if (c == 'B' || c == 'S') {                                     // B36/S23, S23/B36, b36s23
+        bool seen[2] = { false, false };
+        while (*s) {
+            c = toupper((unsigned char)*s);
+            int k = (c == 'B') ? 0 : (c == 'S') ? 1 : -1;
+            if (k < 0 || seen[k]) {
+                return false;
+            }
+            seen[k] = true;
+            s = parse_counts(s + 1, k ? &survive : &birth);
+            if (*s == '/' && s[1]) {
+                s++;
+            }
+        }
+        if (!seen[0] || !seen[1]) {
+            return false;
+        }
+    } else {                                                        // 23/36: survival counts, then birth counts
+        s = parse_counts(s, &survive);
+        if (*s++ != '/') {
+            return false;
+        }
+        s = parse_counts(s, &birth);
+        if (*s) {
+            return false;
+        }
+    }
+
+    if (birth & 1) {
+        return false;                                               // B0: every empty region would flash on
+    }
+    rule_init(R, birth, survive);
+    return true;
+}
+
+
+void rule_name(const life_rule* R, char* buf, size_t size) {
+    char tmp[24];
+    size_t len = 0;
+    tmp[len++] = 'B';
+    for (int n = 0; n < 9; n++) {
+        if ((R->birth >> n) & 1) tmp[len++] = '0' + n;
+    }
+    tmp[len++] = '/';
+    tmp[len++] = 'S';
+    for (int n = 0; n < 9; n++) {
+        if ((R->survive >> n) & 1) tmp[len++] = '0' + n;
+    }
+    tmp[len] = 0;
+    snprintf(buf, size, "%s", tmp);
+}
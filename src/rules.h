@@ -0,0 +1,75 @@
+/*
+ -------------------------------------
+ File:    rules.h
+ Project: conway-game-of-life
+ Header for outer-totalistic (B/S) rules
+ -------------------------------------
+ Author:  Akshath Wikramanayake
+ Email:   akshath.wikramanayake@gmail.com
+ Version  0.0.1
+ -------------------------------------
+ */
+
+#ifndef RULES_H
+#define RULES_H
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#define RULE_LIFE_BIRTH (1u << 3)                       // B3
+#define RULE_LIFE_SURVIVE ((1u << 2) | (1u << 3))       // S23
+
+
+enum kernel_enum {
+    KERNEL_LIFE = 0,            // B3/S23: hardcoded full-adder comparison (see life_word)
+    KERNEL_TABLE,               // any other rule: bit-sliced neighbour count matched against the rule tables (see rule_word)
+};
+
+
+/*
+    Outer-totalistic rule: the next state of a tile only depends on its own state and its # of living neighbours.
+    The rule is compiled once by rule_init into the tables used by the update kernels.
+*/
+typedef struct _life_rule {
+    uint16_t birth;             // bit n set: a dead tile with n living neighbours comes to life
+    uint16_t survive;           // bit n set: a living tile with n living neighbours stays alive
+    size_t kernel;              // word kernel used by the bit-packed engines (see kernel_enum)
+    uint64_t born[9];           // all 1s if birth has bit n, else 0 (lets the table kernel select without branches)
+    uint64_t kept[9];           // all 1s if survive has bit n, else 0
+} life_rule;
+
+
+/*
+    Compiles a rule from its birth/survival masks and selects the kernel that computes it
+    birth, survive: bit n set for each neighbour count n (0-8) that gives/keeps life
+*/
+void rule_init(life_rule*, uint16_t birth, uint16_t survive);
+
+
+/*
+    Parses a rulestring: "B36/S23" (case-insensitive, the slash is optional, B and S may come in either order)
+    or the older "23/36" survival/birth notation. Rules with B0 are rejected: they bring the empty background to life.
+    returns: true on success (the rule is compiled) | false if the string is not a supported rule
+*/
+bool parse_rule(const char* s, life_rule*);
+
+
+/*
+    Writes the rulestring of a rule in B/S notation (e.g. "B36/S23") to buf
+*/
+void rule_name(const life_rule*, char* buf, size_t size);
+
+
+/*
+    Checks if a tile will have life on the next cycle based on current life status & # of living neighbours
+    current: current life status of the tile
+    nbrs: # of living neighbours
+    return: true: will have life | false: won't have life
+*/
+static inline
+bool test_life(const life_rule* rule, bool current, size_t nbrs) {
+    return ((current ? rule->survive : rule->birth) >> nbrs) & 1;     // 9-entry survival/birth lookup tables
+}
+
+#endif
@@ -0,0 +1,177 @@
+/*
+ -------------------------------------
+ File:    soup.c
+ Project: conway-game-of-life
+ Parallel soup search: many small random boards run to completion on all cores
+ -------------------------------------
+ Author:  Akshath Wikramanayake
+ Email:   akshath.wikramanayake@gmail.com
+ Version  0.0.1
+ -------------------------------------
+ */
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+
+#include "life_functions.h"
+#include "cycle.h"
+#include "soup.h"
+
+
+/*
+    State of one worker thread
+*/
+typedef struct _soup_worker {
+    const soup_params* P;
+    soup_queue* queues;         // queues of all workers (the worker owns queues[id])
+    size_t id;
+    FILE* out;
+    soup_stats stats;           // totals of the soups run by this worker
+    pthread_t thread;
+} soup_worker;
+
+
+/*
+    Moves the back half of the fullest other queue into the worker's own (empty) queue
+    returns: true if soups were stolen | false if every queue is empty (the search is over)
+*/
+static
+bool steal(soup_worker* W) {
+    size_t n = W->P->n_workers;
+    while (true) {
+        size_t victim = n;
+        size_t most = 0;
+        for (size_t k = 0; k < n; k++) {                            // unlocked peek: only used to pick a victim
+            soup_queue* q = &W->queues[k];
+            size_t next = atomic_load_explicit(&q->next, memory_order_relaxed);
+            size_t end = atomic_load_explicit(&q->end, memory_order_relaxed);
+            if (k != W->id && next < end && end - next > most) {
+                most = end - next;
+                victim = k;
+            }
+        }
+        if (victim == n) {
+            return false;
+        }
+        soup_queue* q = &W->queues[victim];
+        pthread_mutex_lock(&q->mtx);
+        size_t left = (q->next < q->end) ? q->end - q->next : 0;
+        size_t mid = q->end - (left + 1) / 2;                       // a single soup left is taken as well
+        size_t end = q->end;
+        if (left) {
+            q->end = mid;
+        }
+        pthread_mutex_unlock(&q->mtx);
+        if (left) {
+            soup_queue* own = &W->queues[W->id];
+            pthread_mutex_lock(&own->mtx);
+            own->next = mid;
+            own->end = end;
+            pthread_mutex_unlock(&own->mtx);
+            W->stats.steals++;
+            return true;
+        }
+    }                                                               // the victim ran dry meanwhile: look again
+}
+
+
+/*
+    Takes the next soup from the worker's own queue, stealing when it is empty
+    k: receives the soup #
+    returns: true if a soup was taken | false if no soups are left anywhere
+*/
+static
+bool next_soup(soup_worker* W, size_t* k) {
+    soup_queue* own = &W->queues[W->id];
+    do {
+        pthread_mutex_lock(&own->mtx);
+        bool found = own->next < own->end;
+        if (found) {
+            *k = own->next++;
+        }
+        pthread_mutex_unlock(&own->mtx);
+        if (found) {
+            return true;
+        }
+    } while (steal(W));
+    return false;
+}
+
+
+static
+void* soup_thread(void* Wv) {
+    soup_worker* W = Wv;
+    const soup_params* P = W->P;
+    game_state G;
+    init_game(&G, P->n_rows, P->n_cols, P->maxiters, P->toroidal);    // one game per worker, reused for every soup
+    G.engine = P->engine;
+    G.rule = P->rule;
+
+    size_t k;
+    while (next_soup(W, &k)) {
+        uint64_t seed = P->seed + k;
+        G.generation = 0;
+        G.updates = 0;
+        board_randomise(G.B, P->density, seed);
+        game_start(&G);
+        while (G.stop_reason == STOP_NONE && game_advance(&G)) {     // maxiters may be 0
+        }
+        size_t pop = board_population(G.B);
+        size_t period = (G.stop_reason == STOP_CYCLE) ? G.cycle->period : 0;
+        fprintf(W->out, "%llu,%zu,%s,%zu,%zu\n", (unsigned long long)seed, pop,    // stdio locks the stream per call
+                stop_reason_name(G.stop_reason), G.generation, period);
+        W->stats.soups++;
+        W->stats.stops[G.stop_reason]++;
+        W->stats.generations += G.generation;
+    }
+    destroy_game(&G);
+    return 0;
+}
+
+
+void soup_search(const soup_params* P, FILE* out, soup_stats* stats) {
+    size_t n = P->n_workers ? P->n_workers : 1;
+    soup_params params = *P;
+    params.n_workers = n;
+    soup_queue* queues = game_calloc(n, sizeof(soup_queue));
+    soup_worker* workers = game_calloc(n, sizeof(soup_worker));
+    for (size_t w = 0; w < n; w++) {                                // contiguous initial ranges, rebalanced by stealing
+        pthread_mutex_init(&queues[w].mtx, 0);
+        queues[w].next = P->n_soups * w / n;
+        queues[w].end = P->n_soups * (w + 1) / n;
+        workers[w].P = &params;
+        workers[w].queues = queues;
+        workers[w].id = w;
+        workers[w].out = out;
+    }
+
+    fprintf(out, "seed,population,stop,generation,period\n");
+    uint64_t start = clock_ns();
+    for (size_t w = 1; w < n; w++) {                                // worker 0 is the calling thread
+        pthread_create(&workers[w].thread, 0, soup_thread, &workers[w]);
+    }
+    soup_thread(&workers[0]);
+    for (size_t w = 1; w < n; w++) {
+        pthread_join(workers[w].thread, 0);
+    }
+    fflush(out);
+
+    memset(stats, 0, sizeof(soup_stats));
+    stats->secs = (clock_ns() - start) * 1e-9;
+    for (size_t w = 0; w < n; w++) {                                // reduce the per-worker totals
+        stats->soups += workers[w].stats.soups;
+        stats->generations += workers[w].stats.generations;
+        stats->steals += workers[w].stats.steals;
+        for (size_t r = 0; r <= STOP_FAILED; r++) {
+            stats->stops[r] += workers[w].stats.stops[r];
+        }
+        pthread_mutex_destroy(&queues[w].mtx);
+    }
+    free(workers);
+    free(queues);
+}
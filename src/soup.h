@@ -0,0 +1,78 @@
+/*
+ -------------------------------------
+ File:    soup.h
+ Project: conway-game-of-life
+ Header for the parallel soup search
+ -------------------------------------
+ Author:  Akshath Wikramanayake
+ Email:   akshath.wikramanayake@gmail.com
+ Version  0.0.1
+ -------------------------------------
+ */
+
+#ifndef SOUP_H
+#define SOUP_H
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+
+#include "life_functions.h"
+
+
+/*
+    Settings shared by every soup of a search
+*/
+typedef struct _soup_params {
+    size_t n_rows;              // board size of each soup
+    size_t n_cols;
+    size_t maxiters;            // maximum # of updates per soup
+    bool toroidal;              // board geometry
+    size_t engine;              // update algorithm (bounded engines only: bitwise, naive or lut)
+    life_rule rule;             // birth/survival rule
+    double density;             // probability of each tile being alive
+    uint64_t seed;              // soup k is filled from the PRNG seeded with seed + k
+    size_t n_soups;             // # of soups to run
+    size_t n_workers;           // # of worker threads
+} soup_params;
+
+
+/*
+    Range of soups owned by a worker: the owner takes soups from the front, thieves take the back half
+*/
+typedef struct _soup_queue {
+    pthread_mutex_t mtx;        // serialises the changes to next and end
+    atomic_size_t next;         // next soup to run (atomic: thieves peek at it without the lock)
+    atomic_size_t end;          // one past the last soup of the range
+    char pad[64];               // keep the queues of different workers on separate cache lines
+} soup_queue;
+
+
+/*
+    Totals of a soup search
+*/
+typedef struct _soup_stats {
+    size_t soups;               // # of soups run
+    size_t stops[STOP_FAILED + 1];  // # of soups per stop reason (see stop_enum)
+    size_t generations;         // # of generations computed over all soups
+    size_t steals;              // # of times a worker took soups from another worker's range
+    double secs;                // wall-clock time of the search
+} soup_stats;
+
+
+/*
+    Runs n_soups random boards on n_workers threads, each soup until it stops (steady state, cycle or maxiters).
+    Every worker reuses one game (init_game once, board_randomise + game_start per soup); idle workers steal
+    half of the remaining soups of the busiest worker. Results do not depend on the # of workers.
+    One CSV line per soup is streamed to out as soon as it finishes: seed, population, stop reason,
+    generation and cycle period (0 if none).
+    P: search settings
+    out: stream that receives the per-soup lines (a header line is written first)
+    stats: receives the totals
+*/
+void soup_search(const soup_params* P, FILE* out, soup_stats* stats);
+
+#endif
@@ -0,0 +1,383 @@
+/*
+ -------------------------------------
+ File:    sparse.c
+ Project: conway-game-of-life
+ Unbounded universe stored as a hash map of 64 x 64 chunks
+ -------------------------------------
+ Author:  Akshath Wikramanayake
+ Email:   akshath.wikramanayake@gmail.com
+ Version  0.0.1
+ -------------------------------------
+ */
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "life_functions.h"
+#include "sparse.h"
+
+
+// neighbour directions: NW, N, NE, W, E, SW, S, SE (direction 7 - d is the opposite of d)
+static const int dir_y[8] = { -1, -1, -1, 0, 0, 1, 1, 1 };
+static const int dir_x[8] = { -1, 0, 1, -1, 1, -1, 0, 1 };
+
+
+static inline
+size_t hash_coords(int64_t cy, int64_t cx) {
+    uint64_t h = (uint64_t)cy * 0x9E3779B97F4A7C15ull;
+    h = (h ^ (uint64_t)cx) * 0xC2B2AE3D27D4EB4Full;
+    return h ^ (h >> 29);
+}
+
+
+/*
+    Position of row r of a chunk used in the universe hash (see word_hash)
+*/
+static inline
+size_t row_pos(const chunk* c, size_t r) {
+    return ((uint64_t)c->cy * 0xD6E8FEB86659FD93ull ^ (uint64_t)c->cx * 0xA0761D6478BD642Full) + r;
+}
+
+
+static
+chunk* find_chunk(const sparse_grid* S, int64_t cy, int64_t cx) {
+    for (chunk* c = S->buckets[hash_coords(cy, cx) & (S->n_buckets - 1)]; c; c = c->next) {
+        if (c->cy == cy && c->cx == cx) {
+            return c;
+        }
+    }
+    return NULL;
+}
+
+
+/*
+    Doubles the hash table and reinserts every chunk
+*/
+static
+void grow_buckets(sparse_grid* S) {
+    free(S->buckets);
+    S->n_buckets *= 2;
+    S->buckets = game_calloc(S->n_buckets, sizeof(chunk*));
+    for (size_t i = 0; i < S->n_chunks; i++) {
+        chunk* c = S->chunks[i];
+        chunk** head = &S->buckets[hash_coords(c->cy, c->cx) & (S->n_buckets - 1)];
+        c->next = *head;
+        *head = c;
+    }
+}
+
+
+/*
+    Takes a chunk from the free list, allocating a new slab of chunks if it is empty
+*/
+static
+chunk* alloc_chunk(sparse_grid* S) {
+    if (!S->free_list) {
+        if ((S->n_slabs & (S->n_slabs - 1)) == 0) {                 // slab list is full when its size is a power of 2
+            void** slabs = game_malloc((S->n_slabs ? 2 * S->n_slabs : 1) * sizeof(void*));
+            memcpy(slabs, S->slabs, S->n_slabs * sizeof(void*));
+            free(S->slabs);
+            S->slabs = slabs;
+        }
+        chunk* slab = game_malloc(CHUNK_SLAB * sizeof(chunk));
+        S->slabs[S->n_slabs++] = slab;
+        for (size_t k = 0; k < CHUNK_SLAB; k++) {
+            slab[k].next = S->free_list;
+            S->free_list = &slab[k];
+        }
+    }
+    chunk* c = S->free_list;
+    S->free_list = c->next;
+    return c;
+}
+
+
+/*
+    Allocates an empty chunk at the given coordinates and links it to its neighbours. The chunk is
+    recomputed in the next update.
+*/
+static
+chunk* add_chunk(sparse_grid* S, int64_t cy, int64_t cx) {
+    if (S->n_chunks == S->n_buckets) {                              // keep at most 1 chunk per bucket on average
+        grow_buckets(S);
+    }
+    if (S->n_chunks == S->max_chunks) {
+        chunk** chunks = game_malloc(2 * S->max_chunks * sizeof(chunk*));
+        memcpy(chunks, S->chunks, S->n_chunks * sizeof(chunk*));
+        free(S->chunks);
+        S->chunks = chunks;
+        S->max_chunks *= 2;
+    }
+
+    chunk* c = alloc_chunk(S);
+    memset(c->cells, 0, sizeof(c->cells));
+    c->cy = cy;
+    c->cx = cx;
+    c->active_gen = S->generation;
+    c->changed_gen = 0;
+    c->empty = true;
+
+    chunk** head = &S->buckets[hash_coords(cy, cx) & (S->n_buckets - 1)];
+    c->next = *head;
+    *head = c;
+    c->index = S->n_chunks;
+    S->chunks[S->n_chunks++] = c;
+    if (S->n_chunks > S->peak_chunks) {
+        S->peak_chunks = S->n_chunks;
+    }
+
+    for (int d = 0; d < 8; d++) {
+        chunk* n = find_chunk(S, cy + dir_y[d], cx + dir_x[d]);
+        c->nbr[d] = n;
+        if (n) {
+            n->nbr[7 - d] = c;
+        }
+    }
+    return c;
+}
+
+
+/*
+    Unlinks a chunk from the hash table, the chunk list and its neighbours and puts it on the free list
+*/
+static
+void remove_chunk(sparse_grid* S, chunk* c) {
+    chunk** p = &S->buckets[hash_coords(c->cy, c->cx) & (S->n_buckets - 1)];
+    while (*p != c) {
+        p = &(*p)->next;
+    }
+    *p = c->next;
+
+    chunk* last = S->chunks[--S->n_chunks];
+    S->chunks[c->index] = last;
+    last->index = c->index;
+
+    for (int d = 0; d < 8; d++) {
+        if (c->nbr[d]) {
+            c->nbr[d]->nbr[7 - d] = NULL;
+        }
+    }
+    c->next = S->free_list;
+    S->free_list = c;
+}
+
+
+/*
+    true if the chunk has living cells on the edge (or corner) facing direction d in the given buffer
+*/
+static
+bool has_edge(const chunk* c, int buf, int d) {
+    const uint64_t* rows = c->cells[buf];
+    uint64_t top = rows[0];
+    uint64_t bottom = rows[CHUNK_SIZE - 1];
+    switch (d) {
+        case 0: return top & 1;
+        case 1: return top != 0;
+        case 2: return top >> 63;
+        case 5: return bottom & 1;
+        case 6: return bottom != 0;
+        case 7: return bottom >> 63;
+    }
+    uint64_t bit = (d == 3) ? 1 : (uint64_t)1 << 63;                // west edge is bit 0, east edge is bit 63
+    for (size_t r = 0; r < CHUNK_SIZE; r++) {
+        if (rows[r] & bit) {
+            return true;
+        }
+    }
+    return false;
+}
+
+
+/*
+    Allocates the missing neighbours that living cells on the edges of the chunk can give birth in
+*/
+static
+void ensure_neighbours(sparse_grid* S, chunk* c, int buf) {
+    for (int d = 0; d < 8; d++) {
+        if (!c->nbr[d] && has_edge(c, buf, d)) {
+            add_chunk(S, c->cy + dir_y[d], c->cx + dir_x[d]);
+        }
+    }
+}
+
+
+sparse_grid* create_sparse_grid(const life_rule* rule) {
+    sparse_grid* S = game_malloc(sizeof(sparse_grid));
+    S->rule = *rule;
+    S->n_buckets = 64;
+    S->buckets = game_calloc(S->n_buckets, sizeof(chunk*));
+    S->max_chunks = 64;
+    S->chunks = game_malloc(S->max_chunks * sizeof(chunk*));
+    S->n_chunks = 0;
+    S->free_list = NULL;
+    S->slabs = NULL;
+    S->n_slabs = 0;
+    S->peak_chunks = 0;
+    S->generation = 0;
+    S->hash = 0;
+    return S;
+}
+
+
+void destroy_sparse_grid(sparse_grid* S) {
+    for (size_t k = 0; k < S->n_slabs; k++) {
+        free(S->slabs[k]);
+    }
+    free(S->slabs);
+    free(S->chunks);
+    free(S->buckets);
+    free(S);
+}
+
+
+void sparse_load(sparse_grid* S, const board* B, int64_t y0, int64_t x0) {
+    while (S->n_chunks) {                                           // drop the old universe
+        remove_chunk(S, S->chunks[S->n_chunks - 1]);
+    }
+    S->generation = 0;
+    S->hash = 0;
+
+    uint64_t last_mask = last_word_mask(B);
+    for (size_t i = 0; i < B->n_rows; i++) {
+        const uint64_t* row = board_row(B, i + 1);
+        int64_t y = y0 + (int64_t)i;
+        for (size_t w = 1; w < B->stride - 1; w++) {
+            uint64_t v = row[w] & ((w == B->stride - 2) ? last_mask : ~(uint64_t)0);
+            if (!v) {
+                continue;
+            }
+            int64_t x = x0 + 64 * (int64_t)(w - 1);
+            int s = x & 63;                                         // the word straddles two chunks unless x is aligned
+            chunk* a = find_chunk(S, y >> 6, x >> 6);
+            if (!a) a = add_chunk(S, y >> 6, x >> 6);
+            a->cells[0][y & 63] |= v << s;
+            if (s) {
+                chunk* b = find_chunk(S, y >> 6, (x >> 6) + 1);
+                if (!b) b = add_chunk(S, y >> 6, (x >> 6) + 1);
+                b->cells[0][y & 63] |= v >> (64 - s);
+            }
+        }
+    }
+
+    for (size_t i = 0; i < S->n_chunks; i++) {                      // chunks added here are empty: the loop ends
+        chunk* c = S->chunks[i];
+        for (size_t r = 0; r < CHUNK_SIZE; r++) {
+            S->hash ^= word_hash(row_pos(c, r), c->cells[0][r]);
+            c->empty &= (c->cells[0][r] == 0);
+        }
+        ensure_neighbours(S, c, 0);
+    }
+}
+
+
+/*
+    Computes the next generation of a chunk into its back buffer
+    life: true: B3/S23 kernel | false: table kernel for rule (a constant, see update_bitwise_with)
+    returns: # of cells of the chunk that changed and the universe hash update
+*/
+static inline __attribute__((always_inline))
+step_result step_chunk(chunk* c, int cur, const life_rule* rule, bool life) {
+    uint64_t pad[CHUNK_SIZE + 2][3];                                // rows -1..64 of the chunk and its west/east neighbours
+    const chunk* const* nb = (const chunk* const*)c->nbr;
+    for (size_t r = 0; r < CHUNK_SIZE; r++) {
+        pad[r + 1][0] = nb[3] ? nb[3]->cells[cur][r] : 0;
+        pad[r + 1][1] = c->cells[cur][r];
+        pad[r + 1][2] = nb[4] ? nb[4]->cells[cur][r] : 0;
+    }
+    for (int k = 0; k < 3; k++) {
+        pad[0][k] = nb[k] ? nb[k]->cells[cur][CHUNK_SIZE - 1] : 0;
+        pad[CHUNK_SIZE + 1][k] = nb[5 + k] ? nb[5 + k]->cells[cur][0] : 0;
+    }
+
+    step_result res = step_init();
+    uint64_t any = 0;
+    uint64_t* out = c->cells[cur ^ 1];
+    for (size_t r = 0; r < CHUNK_SIZE; r++) {
+        uint64_t next = life ? life_word(pad[r], pad[r + 1], pad[r + 2], 1) : rule_word(rule, pad[r], pad[r + 1], pad[r + 2], 1);
+        uint64_t diff = next ^ pad[r + 1][1];
+        if (diff) {
+            res.changed += __builtin_popcountll(diff);
+            res.births += __builtin_popcountll(diff & next);
+            res.hash ^= word_hash(row_pos(c, r), pad[r + 1][1]) ^ word_hash(row_pos(c, r), next);
+        }
+        out[r] = next;
+        any |= next;
+    }
+    c->empty = (any == 0);
+    return res;
+}
+
+
+step_result sparse_step(sparse_grid* S) {
+    int cur = S->generation & 1;
+    uint64_t gen = ++S->generation;                                 // generation being computed
+    size_t n = S->n_chunks;
+    step_result res = step_init();
+
+    for (size_t i = 0; i < n; i++) {                                // quiet chunks already hold their value in the back buffer
+        chunk* c = S->chunks[i];
+        if (c->active_gen != gen - 1) {
+            continue;
+        }
+        step_result r = (S->rule.kernel == KERNEL_LIFE) ? step_chunk(c, cur, &S->rule, true) : step_chunk(c, cur, &S->rule, false);
+        if (r.changed) {
+            c->changed_gen = gen;
+            step_merge(&res, &r);
+        }
+    }
+
+    for (size_t i = 0; i < n; i++) {                                // wake up the neighbourhoods of the changed chunks
+        chunk* c = S->chunks[i];
+        if (c->changed_gen != gen) {
+            continue;
+        }
+        c->active_gen = gen;
+        for (int d = 0; d < 8; d++) {
+            if (c->nbr[d]) {
+                c->nbr[d]->active_gen = gen;
+            }
+        }
+        ensure_neighbours(S, c, cur ^ 1);                           // new chunks are active in the next update
+    }
+
+    if (gen % SPARSE_SWEEP == 0) {                                  // reclaim empty chunks nothing can be born in
+        for (size_t i = S->n_chunks; i-- > 0; ) {
+            chunk* c = S->chunks[i];
+            bool needed = !c->empty;
+            for (int d = 0; d < 8 && !needed; d++) {
+                needed = c->nbr[d] && has_edge(c->nbr[d], cur ^ 1, 7 - d);
+            }
+            if (!needed) {
+                remove_chunk(S, c);
+            }
+        }
+    }
+
+    S->hash ^= res.hash;
+    return res;
+}
+
+
+void sparse_extract(const sparse_grid* S, board* B, int64_t y0, int64_t x0) {
+    int cur = S->generation & 1;
+    uint64_t last_mask = last_word_mask(B);
+    memset(B->data, 0, (B->n_rows + 2) * B->stride * sizeof(uint64_t));
+    for (size_t i = 0; i < B->n_rows; i++) {
+        uint64_t* row = board_row(B, i + 1);
+        int64_t y = y0 + (int64_t)i;
+        int64_t x = x0;
+        int s = x & 63;
+        const chunk* a = find_chunk(S, y >> 6, x >> 6);
+        for (size_t w = 1; w < B->stride - 1; w++, x += 64) {
+            const chunk* b = s ? find_chunk(S, y >> 6, (x >> 6) + 1) : NULL;
+            uint64_t v = a ? a->cells[cur][y & 63] >> s : 0;
+            if (b) {
+                v |= b->cells[cur][y & 63] << (64 - s);
+            }
+            row[w] = v & ((w == B->stride - 2) ? last_mask : ~(uint64_t)0);
+            a = s ? b : find_chunk(S, y >> 6, (x >> 6) + 1);        // the next word starts in the chunk this one ended in
+        }
+    }
+}
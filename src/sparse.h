@@ -0,0 +1,96 @@
+/*
+ -------------------------------------
+ File:    sparse.h
+ Project: conway-game-of-life
+ Header for the unbounded chunked sparse grid engine
+ -------------------------------------
+ Author:  Akshath Wikramanayake
+ Email:   akshath.wikramanayake@gmail.com
+ Version  0.0.1
+ -------------------------------------
+ */
+
+#ifndef SPARSE_H
+#define SPARSE_H
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "life_functions.h"
+
+#define CHUNK_SIZE 64                   // chunks are CHUNK_SIZE x CHUNK_SIZE cells (one word per row)
+#define CHUNK_SLAB 256                  // # of chunks allocated at a time
+#define SPARSE_SWEEP 16                 // empty chunks are reclaimed every SPARSE_SWEEP generations
+
+
+/*
+    64 x 64 block of the universe. Cell (i, j) of the chunk is bit j of row i; the chunk with coordinates
+    (cy, cx) holds cells (cy * 64 + i, cx * 64 + j).
+    A chunk is allocated whenever one of its neighbours has living cells on the shared edge, so every cell
+    that can be born lies in an allocated chunk.
+*/
+typedef struct _chunk {
+    uint64_t cells[2][CHUNK_SIZE];  // double-buffered rows: buffer (generation & 1) holds the current generation
+    int64_t cy, cx;                 // chunk coordinates
+    struct _chunk* nbr[8];          // neighbouring chunks (NULL: not allocated), see the order in sparse.c
+    struct _chunk* next;            // next chunk in the hash chain / free list
+    size_t index;                   // position in the list of allocated chunks
+    uint64_t active_gen;            // the chunk is recomputed in the update from this generation
+    uint64_t changed_gen;           // generation in which the chunk last changed
+    bool empty;                     // true if the chunk has no living cells in the current generation
+} chunk;
+
+
+typedef struct _sparse_grid {
+    chunk** buckets;            // hash table of the allocated chunks keyed by chunk coordinates (heads of the chains)
+    size_t n_buckets;           // power of 2, at least the # of chunks
+    chunk** chunks;             // allocated chunks, in no particular order
+    size_t n_chunks;            // # of allocated chunks
+    size_t max_chunks;          // # of slots in chunks
+    chunk* free_list;           // reclaimed chunks, reused before new slabs are allocated
+    void** slabs;               // blocks of CHUNK_SLAB chunks
+    size_t n_slabs;
+    size_t peak_chunks;         // largest # of chunks allocated at once
+
+    uint64_t generation;        // current generation
+    uint64_t hash;              // hash of the whole universe, updated incrementally (see word_hash)
+    life_rule rule;             // birth/survival rule (B0 rules are not supported: cells are only born next to living ones)
+} sparse_grid;
+
+
+/*
+    Allocates an empty universe
+    rule: birth/survival rule the universe evolves under
+    returns: pointer to the new universe
+*/
+sparse_grid* create_sparse_grid(const life_rule* rule);
+
+
+/*
+    Deallocates a universe
+*/
+void destroy_sparse_grid(sparse_grid*);
+
+
+/*
+    Replaces the universe with the contents of the board and makes it generation 0.
+    Cell (i, j) of the board becomes cell (y0 + i, x0 + j) of the universe; the halo of the board is ignored.
+*/
+void sparse_load(sparse_grid*, const board* B, int64_t y0, int64_t x0);
+
+
+/*
+    Advances the universe by one generation. Only chunks whose 3x3 neighbourhood of chunks changed in the
+    last generation are recomputed.
+    returns: # of cells whose life/death status changed anywhere in the universe and the update of the universe hash
+*/
+step_result sparse_step(sparse_grid*);
+
+
+/*
+    Writes the window of the universe with top-left cell (y0, x0) and the size of the board to the board
+*/
+void sparse_extract(const sparse_grid*, board* B, int64_t y0, int64_t x0);
+
+#endif
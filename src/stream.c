@@ -0,0 +1,491 @@
+/*
+ -------------------------------------
+ File:    stream.c
+ Project: conway-game-of-life
+ Out-of-core engine: boards larger than memory are streamed through a file one band of rows at a time
+ -------------------------------------
+ Author:  Akshath Wikramanayake
+ Email:   akshath.wikramanayake@gmail.com
+ Version  0.0.1
+ -------------------------------------
+ */
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdbool.h>
+#include <pthread.h>
+
+#include "life_functions.h"
+#include "checkpoint.h"
+#include "rules.h"
+#include "stream.h"
+
+
+/*
+    State of a run: the resident window and the I/O threads
+*/
+typedef struct _stream_ctx {
+    const stream_params* P;
+    checkpoint_header header;   // header of the file (updated after every generation)
+    char* next_path;            // path.next: receives the next generation
+    size_t band_rows;           // # of rows per band
+    size_t n_bands;
+    uint64_t* in[STREAM_BANDS];     // band k is read into in[k % STREAM_BANDS]
+    uint64_t* out[STREAM_OUT_BANDS];    // band k is computed into out[k % STREAM_OUT_BANDS]
+    uint64_t* top;              // row above the first row (the last row or the wall)
+    uint64_t* bottom;           // row below the last row (the first row or the wall)
+    uint64_t* above;            // last row of the previous band
+    uint64_t* spare;            // halo rows of the input, only read for the checksum
+    uint64_t* zeros;            // halo rows of the output
+    stream_io rd;
+    stream_io wr;
+    uint64_t stall_ns;          // time spent in io_wait
+} stream_ctx;
+
+
+static
+void* io_thread(void* Iv) {
+    stream_io* I = Iv;
+    pthread_mutex_lock(&I->mtx);
+    while (true) {
+        while (!I->busy && !I->quit) {
+            pthread_cond_wait(&I->cond, &I->mtx);
+        }
+        if (!I->busy) {
+            break;
+        }
+        pthread_mutex_unlock(&I->mtx);                              // the buffer is not touched by the compute thread while busy
+        uint64_t t0 = clock_ns();
+        size_t done = I->write ? fwrite(I->buf, sizeof(uint64_t), I->words, I->file)
+                               : fread(I->buf, sizeof(uint64_t), I->words, I->file);
+        checksum_add(&I->sum, I->buf, I->words);
+        uint64_t t1 = clock_ns();
+        pthread_mutex_lock(&I->mtx);
+        I->ok = I->ok && done == I->words;
+        I->bytes += done * sizeof(uint64_t);
+        I->busy_ns += t1 - t0;
+        I->busy = false;
+        pthread_cond_broadcast(&I->cond);
+    }
+    pthread_mutex_unlock(&I->mtx);
+    return 0;
+}
+
+
+static
+void io_start(stream_io* I, bool write) {
+    I->file = NULL;
+    I->write = write;
+    pthread_mutex_init(&I->mtx, 0);
+    pthread_cond_init(&I->cond, 0);
+    I->busy = false;
+    I->quit = false;
+    I->ok = true;
+    I->bytes = 0;
+    I->busy_ns = 0;
+    pthread_create(&I->thread, 0, io_thread, I);
+}
+
+
+static
+void io_stop(stream_io* I) {
+    pthread_mutex_lock(&I->mtx);
+    I->quit = true;
+    pthread_cond_broadcast(&I->cond);
+    pthread_mutex_unlock(&I->mtx);
+    pthread_join(I->thread, 0);
+    pthread_cond_destroy(&I->cond);
+    pthread_mutex_destroy(&I->mtx);
+}
+
+
+/*
+    Points an idle I/O thread at a new file and restarts its checksum
+*/
+static
+void io_set(stream_io* I, FILE* file) {
+    pthread_mutex_lock(&I->mtx);
+    I->file = file;
+    I->ok = true;
+    checksum_start(&I->sum);
+    pthread_mutex_unlock(&I->mtx);
+}
+
+
+/*
+    Hands the next sequential transfer to an idle I/O thread
+*/
+static
+void io_submit(stream_io* I, uint64_t* buf, size_t words) {
+    pthread_mutex_lock(&I->mtx);
+    I->buf = buf;
+    I->words = words;
+    I->busy = true;
+    pthread_cond_broadcast(&I->cond);
+    pthread_mutex_unlock(&I->mtx);
+}
+
+
+/*
+    Waits for the transfer handed over last to finish
+    returns: false if a transfer of the current file failed
+*/
+static
+bool io_wait(stream_io* I, uint64_t* stall_ns) {
+    pthread_mutex_lock(&I->mtx);
+    if (I->busy) {
+        uint64_t t0 = clock_ns();
+        while (I->busy) {
+            pthread_cond_wait(&I->cond, &I->mtx);
+        }
+        *stall_ns += clock_ns() - t0;
+    }
+    bool ok = I->ok;
+    pthread_mutex_unlock(&I->mtx);
+    return ok;
+}
+
+
+/*
+    Moves to a byte offset of a file (board files are usually larger than a long can address on Windows)
+*/
+static
+bool seek_to(FILE* f, uint64_t offset) {
+#ifdef _WIN32
+    return _fseeki64(f, (long long)offset, SEEK_SET) == 0;
+#else
+    return fseeko(f, (off_t)offset, SEEK_SET) == 0;
+#endif
+}
+
+
+/*
+    Writes the header at the start of a checkpoint file (padded to CHECKPOINT_DATA_OFFSET)
+*/
+static
+bool write_header(FILE* f, const checkpoint_header* h) {
+    static const char zeros[CHECKPOINT_DATA_OFFSET];
+    return seek_to(f, 0)
+        && fwrite(h, sizeof(*h), 1, f) == 1
+        && fwrite(zeros, CHECKPOINT_DATA_OFFSET - sizeof(*h), 1, f) == 1;
+}
+
+
+bool stream_create(const char* path, size_t n_rows, size_t n_cols, bool toroidal, const life_rule* rule,
+                   double density, uint64_t seed) {
+    FILE* f = fopen(path, "wb");
+    if (!f) {
+        return false;
+    }
+    checkpoint_header h;
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, CHECKPOINT_MAGIC, sizeof(h.magic));
+    h.version = CHECKPOINT_VERSION;
+    h.toroidal = toroidal;
+    h.n_rows = n_rows;
+    h.n_cols = n_cols;
+    h.stride = (n_cols + 63) / 64 + 2;
+    rule_name(rule, h.rule, sizeof(h.rule));
+
+    size_t stride = h.stride;
+    uint64_t* row = game_calloc(stride, sizeof(uint64_t));         // halo words stay 0
+    uint64_t state = seed;
+    checksum_state sum;
+    checksum_start(&sum);
+    bool ok = write_header(f, &h);                                  // placeholder until the hash and checksum are known
+    for (size_t i = 0; ok && i < n_rows + 2; i++) {
+        if (i >= 1 && i < n_rows + 1) {
+            random_row(row, n_cols, density, &state);
+            for (size_t w = 1; w < stride - 1; w++) {
+                h.hash ^= word_hash(i * stride + w, row[w]);
+            }
+        } else {
+            memset(row, 0, stride * sizeof(uint64_t));
+        }
+        ok = fwrite(row, sizeof(uint64_t), stride, f) == stride;
+        checksum_add(&sum, row, stride);
+    }
+    h.checksum = checksum_end(&sum);
+    ok = ok && write_header(f, &h);
+    ok = (fclose(f) == 0) && ok;
+    free(row);
+    if (!ok) {
+        remove(path);
+    }
+    return ok;
+}
+
+
+/*
+    Prepares rows read from the file for the kernel: clears the bits past the last column and fills in the halo cells
+*/
+static
+void prepare_rows(const stream_ctx* C, uint64_t* rows, size_t n) {
+    const checkpoint_header* h = &C->header;
+    size_t stride = h->stride;
+    uint64_t last_mask = (h->n_cols & 63) ? ((uint64_t)1 << (h->n_cols & 63)) - 1 : ~(uint64_t)0;
+    for (size_t k = 0; k < n; k++) {
+        uint64_t* row = rows + k * stride;
+        row[stride - 1] = 0;
+        row[stride - 2] &= last_mask;
+        fill_row_halo(row, h->n_cols, h->toroidal);
+    }
+}
+
+
+/*
+    Computes the next generation of one band into out[b % STREAM_OUT_BANDS]. The output halo cells are 0s.
+    life: true: B3/S23 kernel (life_word) | false: table kernel for the rule (rule_word). Always a constant,
+          so each variant gets its own inner loop (see update_bitwise_with)
+    returns: changes of the band (changed, births and hash); last receives the population of the band
+*/
+static inline
+step_result compute_band_with(stream_ctx* C, size_t b, bool life) {
+    const checkpoint_header* h = &C->header;
+    size_t stride = h->stride;
+    size_t n_words = stride - 2;
+    uint64_t last_mask = (h->n_cols & 63) ? ((uint64_t)1 << (h->n_cols & 63)) - 1 : ~(uint64_t)0;
+    size_t i0 = b * C->band_rows;
+    size_t n = (i0 + C->band_rows < h->n_rows) ? C->band_rows : h->n_rows - i0;
+    const uint64_t* band = C->in[b % STREAM_BANDS];
+    const uint64_t* below = (b + 1 < C->n_bands) ? C->in[(b + 1) % STREAM_BANDS] : C->bottom;
+    uint64_t* out = C->out[b % STREAM_OUT_BANDS];
+
+    step_result res = { 0 };
+    for (size_t k = 0; k < n; k++) {
+        const uint64_t* mid = band + k * stride;
+        const uint64_t* up = k ? mid - stride : (b ? C->above : C->top);
+        const uint64_t* dn = (k + 1 < n) ? mid + stride : below;
+        uint64_t* o = out + k * stride;
+        size_t i = i0 + k + 1;                                      // padded row index of the row in the file
+        for (size_t w = 1; w < n_words + 1; w++) {
+            uint64_t mask = (w == n_words) ? last_mask : ~(uint64_t)0;
+            uint64_t next = (life ? life_word(up, mid, dn, w) : rule_word(&C->P->rule, up, mid, dn, w)) & mask;
+            uint64_t diff = next ^ (mid[w] & mask);
+            res.changed += __builtin_popcountll(diff);
+            res.births += __builtin_popcountll(diff & next);
+            res.last += __builtin_popcountll(next);
+            res.hash ^= word_hash(i * stride + w, next);
+            o[w] = next;
+        }
+        o[0] = 0;
+        o[stride - 1] = 0;
+    }
+    return res;
+}
+
+
+/*
+    Band update with the kernel selected for the rule
+*/
+static
+step_result compute_band(stream_ctx* C, size_t b) {
+    if (C->P->rule.kernel == KERNEL_LIFE) {
+        return compute_band_with(C, b, true);
+    }
+    return compute_band_with(C, b, false);
+}
+
+
+/*
+    Streams one generation from the file into path.next and renames it over the file (the header is
+    advanced to the new generation)
+    res: receives the changes, the board hash and the population (in last)
+    returns: NULL on success | description of the failure
+*/
+static
+const char* stream_generation(stream_ctx* C, step_result* res) {
+    checkpoint_header* h = &C->header;
+    size_t n_rows = h->n_rows;
+    size_t stride = h->stride;
+    size_t row_bytes = stride * sizeof(uint64_t);
+    const char* path = C->P->path;
+    FILE* src = fopen(path, "rb");
+    FILE* dst = fopen(C->next_path, "wb");
+    if (!src || !dst) {
+        if (src) fclose(src);
+        if (dst) fclose(dst);
+        return "could not open the board files";
+    }
+
+    bool ok = write_header(dst, h);                                 // placeholder until the hash and checksum are known
+    memset(C->top, 0, row_bytes);
+    if (h->toroidal) {                                              // the last row wraps around above the first
+        ok = ok && seek_to(src, CHECKPOINT_DATA_OFFSET + (uint64_t)n_rows * row_bytes)
+                && fread(C->top, sizeof(uint64_t), stride, src) == stride;
+        prepare_rows(C, C->top, 1);
+        C->rd.bytes += row_bytes;                                   // the reader is idle
+    }
+    ok = ok && seek_to(src, CHECKPOINT_DATA_OFFSET);
+    io_set(&C->rd, src);
+    io_set(&C->wr, dst);
+
+    size_t R = C->band_rows;
+    size_t nb = C->n_bands;
+    io_submit(&C->rd, C->spare, stride);                            // halo row 0: only checksummed
+    ok = io_wait(&C->rd, &C->stall_ns) && ok;
+    io_submit(&C->wr, C->zeros, stride);
+    io_submit(&C->rd, C->in[0], (R < n_rows ? R : n_rows) * stride);
+    ok = io_wait(&C->rd, &C->stall_ns) && ok;
+    prepare_rows(C, C->in[0], R < n_rows ? R : n_rows);
+    if (h->toroidal) {                                              // the first row wraps around below the last
+        memcpy(C->bottom, C->in[0], row_bytes);
+    } else {
+        memset(C->bottom, 0, row_bytes);
+    }
+    if (nb > 1) {
+        io_submit(&C->rd, C->in[1], (2 * R < n_rows ? R : n_rows - R) * stride);
+    }
+
+    memset(res, 0, sizeof(*res));
+    for (size_t b = 0; b < nb && ok; b++) {
+        ok = io_wait(&C->rd, &C->stall_ns) && ok;                   // band b + 1 is in
+        if (b + 1 < nb) {
+            size_t i1 = (b + 1) * R;
+            prepare_rows(C, C->in[(b + 1) % STREAM_BANDS], (i1 + R < n_rows) ? R : n_rows - i1);
+        }
+        if (b + 2 < nb) {                                           // read ahead into the buffer of band b - 1
+            size_t i2 = (b + 2) * R;
+            io_submit(&C->rd, C->in[(b + 2) % STREAM_BANDS], ((i2 + R < n_rows) ? R : n_rows - i2) * stride);
+        }
+
+        step_result part = compute_band(C, b);
+        res->changed += part.changed;
+        res->births += part.births;
+        res->hash ^= part.hash;
+        res->last += part.last;
+
+        size_t n = ((b + 1) * R < n_rows) ? R : n_rows - b * R;
+        memcpy(C->above, C->in[b % STREAM_BANDS] + (n - 1) * stride, row_bytes);
+        ok = io_wait(&C->wr, &C->stall_ns) && ok;                   // band b - 1 is out: write behind
+        io_submit(&C->wr, C->out[b % STREAM_OUT_BANDS], n * stride);
+    }
+    ok = io_wait(&C->rd, &C->stall_ns) && ok;
+    io_submit(&C->rd, C->spare, stride);                            // halo row n_rows + 1
+    ok = io_wait(&C->rd, &C->stall_ns) && ok;
+    ok = io_wait(&C->wr, &C->stall_ns) && ok;
+    io_submit(&C->wr, C->zeros, stride);
+    ok = io_wait(&C->wr, &C->stall_ns) && ok;
+
+    const char* err = ok ? NULL : "read or write failed";
+    if (ok && checksum_end(&C->rd.sum) != h->checksum) {
+        err = "checksum of the board file does not match";
+    }
+    if (!err) {
+        h->generation++;
+        h->updates++;
+        h->hash = res->hash;
+        h->checksum = checksum_end(&C->wr.sum);
+        if (!write_header(dst, h)) {
+            err = "write failed";
+        }
+    }
+    fclose(src);
+    if (fclose(dst) != 0 && !err) {
+        err = "write failed";
+    }
+#ifdef _WIN32
+    if (!err) {
+        remove(path);                                               // rename does not replace files on Windows
+    }
+#endif
+    if (!err && rename(C->next_path, path) != 0) {
+        err = "could not replace the board file";
+    }
+    if (err) {
+        remove(C->next_path);
+    }
+    return err;
+}
+
+
+bool stream_run(const stream_params* P, stream_stats* S) {
+    memset(S, 0, sizeof(*S));
+    stream_ctx C;
+    C.P = P;
+    if (!read_checkpoint_header(P->path, &C.header)) {
+        return false;
+    }
+    checkpoint_header* h = &C.header;
+    if (h->updates >= P->maxiters) {                                // already done: the file is left untouched
+        S->n_rows = h->n_rows;
+        S->n_cols = h->n_cols;
+        S->generation = h->generation;
+        S->updates = h->updates;
+        S->stop_reason = STOP_MAXITERS;
+        return true;
+    }
+    rule_name(&P->rule, h->rule, sizeof(h->rule));                  // the rule of the run is recorded in the file
+    size_t stride = h->stride;
+    size_t row_bytes = stride * sizeof(uint64_t);
+    size_t R = P->budget / ((STREAM_BANDS + STREAM_OUT_BANDS) * row_bytes);
+    if (R < 1) R = 1;
+    if (R > h->n_rows) R = h->n_rows;
+    C.band_rows = R;
+    C.n_bands = (h->n_rows + R - 1) / R;
+    for (size_t k = 0; k < STREAM_BANDS; k++) {
+        C.in[k] = game_malloc(R * row_bytes);
+    }
+    for (size_t k = 0; k < STREAM_OUT_BANDS; k++) {
+        C.out[k] = game_malloc(R * row_bytes);
+    }
+    C.top = game_malloc(row_bytes);
+    C.bottom = game_malloc(row_bytes);
+    C.above = game_malloc(row_bytes);
+    C.spare = game_malloc(row_bytes);
+    C.zeros = game_calloc(stride, sizeof(uint64_t));
+    size_t len = strlen(P->path);
+    C.next_path = game_malloc(len + 6);
+    memcpy(C.next_path, P->path, len);
+    memcpy(C.next_path + len, ".next", 6);
+    C.stall_ns = 0;
+    io_start(&C.rd, false);
+    io_start(&C.wr, true);
+
+    S->n_rows = h->n_rows;
+    S->n_cols = h->n_cols;
+    S->band_rows = R;
+    S->window_bytes = (STREAM_BANDS + STREAM_OUT_BANDS) * R * row_bytes + 5 * row_bytes;
+    uint64_t start = clock_ns();
+    while (S->stop_reason == STOP_NONE) {                           // stops like game_advance (without cycle detection)
+        step_result res;
+        S->error = stream_generation(&C, &res);
+        if (S->error) {
+            S->stop_reason = STOP_FAILED;
+            break;
+        }
+        S->steps++;
+        S->population = res.last;
+        if (res.changed == 0) {
+            S->stop_reason = STOP_STEADY;
+        } else if (h->updates >= P->maxiters) {
+            S->stop_reason = STOP_MAXITERS;
+        }
+    }
+    S->secs = (clock_ns() - start) * 1e-9;
+    S->generation = h->generation;
+    S->updates = h->updates;
+
+    io_stop(&C.rd);
+    io_stop(&C.wr);
+    S->bytes_read = C.rd.bytes;
+    S->bytes_written = C.wr.bytes;
+    S->read_ns = C.rd.busy_ns;
+    S->write_ns = C.wr.busy_ns;
+    S->stall_ns = C.stall_ns;
+    for (size_t k = 0; k < STREAM_BANDS; k++) {
+        free(C.in[k]);
+    }
+    for (size_t k = 0; k < STREAM_OUT_BANDS; k++) {
+        free(C.out[k]);
+    }
+    free(C.top);
+    free(C.bottom);
+    free(C.above);
+    free(C.spare);
+    free(C.zeros);
+    free(C.next_path);
+    return true;
+}
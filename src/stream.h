@@ -0,0 +1,110 @@
+/*
+ -------------------------------------
+ File:    stream.h
+ Project: conway-game-of-life
+ Header for the out-of-core engine that streams boards larger than memory through a file
+ -------------------------------------
+ Author:  Akshath Wikramanayake
+ Email:   akshath.wikramanayake@gmail.com
+ Version  0.0.1
+ -------------------------------------
+ */
+
+#ifndef STREAM_H
+#define STREAM_H
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <pthread.h>
+
+#include "life_functions.h"
+#include "checkpoint.h"
+
+#define STREAM_BANDS 3          // input bands resident at once: the band being computed, the next one and the one being read
+#define STREAM_OUT_BANDS 2      // output bands: one being computed, one being written
+
+
+/*
+    Background reader or writer of one file. The compute thread hands over one sequential transfer at a time
+    and only waits when it needs the buffer back, so the disk works while the band is computed.
+*/
+typedef struct _stream_io {
+    FILE* file;
+    bool write;                 // true: writes buf to file | false: reads file into buf
+    uint64_t* buf;              // buffer of the transfer handed over
+    size_t words;               // # of words to transfer
+    checksum_state sum;         // running checksum of every word transferred since the file was set
+
+    pthread_t thread;
+    pthread_mutex_t mtx;        // protects busy and quit, used with cond
+    pthread_cond_t cond;        // signalled when a transfer is handed over or finished
+    bool busy;                  // transfer handed over and not finished
+    bool quit;                  // set to true to make the thread exit
+    bool ok;                    // false once a transfer of the current file failed
+
+    uint64_t bytes;             // # of bytes transferred
+    uint64_t busy_ns;           // time spent transferring
+} stream_io;
+
+
+/*
+    Settings of an out-of-core run
+*/
+typedef struct _stream_params {
+    const char* path;           // checkpoint file that holds the board between generations
+    life_rule rule;             // birth/survival rule
+    size_t maxiters;            // maximum # of updates (counted from the updates of the file)
+    size_t budget;              // bytes of board rows resident at once (the window)
+} stream_params;
+
+
+/*
+    Totals of an out-of-core run
+*/
+typedef struct _stream_stats {
+    size_t n_rows;              // board size
+    size_t n_cols;
+    size_t generation;          // generation of the board in the file
+    size_t updates;             // # of updates in the file (counted against maxiters)
+    size_t steps;               // # of generations computed by the run
+    size_t population;          // # of living tiles of the last generation
+    size_t stop_reason;         // see stop_enum (cycles are not detected)
+    size_t band_rows;           // # of rows per band
+    size_t window_bytes;        // bytes of the band buffers
+    uint64_t bytes_read;
+    uint64_t bytes_written;
+    uint64_t read_ns;           // time the reader spent reading
+    uint64_t write_ns;          // time the writer spent writing
+    uint64_t stall_ns;          // time the compute thread waited for the reader or the writer
+    double secs;                // wall-clock time of the run
+    const char* error;          // cause of STOP_FAILED (NULL otherwise)
+} stream_stats;
+
+
+/*
+    Writes a random board to a new checkpoint file row by row (the same board as board_randomise with the
+    same seed), so boards larger than memory can be created
+    density, seed: see board_randomise
+    rule: rule recorded in the header
+    returns: true on success
+*/
+bool stream_create(const char* path, size_t n_rows, size_t n_cols, bool toroidal, const life_rule* rule,
+                   double density, uint64_t seed);
+
+
+/*
+    Runs the board of a checkpoint file until it stops, without ever holding the whole board in memory.
+    Every generation streams the file once into path.next, which then replaces it: a reader thread reads
+    band k + 2 while band k is computed and a writer thread writes band k - 1, so at most STREAM_BANDS input
+    and STREAM_OUT_BANDS output bands are resident. The checksum of the input is verified as it streams by
+    and the output gets a valid header, so the file can be resumed with -R at any time.
+    Halo cells are stored as 0s in the file. A file that already reached P->maxiters is left untouched.
+    P: run settings
+    S: receives the totals
+    returns: true if the file could be run (S->stop_reason is STOP_FAILED after an I/O or checksum error)
+*/
+bool stream_run(const stream_params* P, stream_stats* S);
+
+#endif
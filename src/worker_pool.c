@@ -0,0 +1,99 @@
+/*
+ -------------------------------------
+ File:    worker_pool.c
+ Project: conway-game-of-life
+ Parallel row-band update engine
+ -------------------------------------
+ Author:  Akshath Wikramanayake
+ Email:   akshath.wikramanayake@gmail.com
+ Version  0.0.1
+ -------------------------------------
+ */
+
+#include <stdlib.h>
+#include <pthread.h>
+#include <stdbool.h>
+
+#include "life_functions.h"
+#include "worker_pool.h"
+
+
+/*
+    Updates the band of rows assigned to a worker and stores its result
+*/
+static
+void update_band(worker_slot* S) {
+    worker_pool* P = S->pool;
+    size_t n_rows = P->G->n_rows;
+    size_t r0 = ((n_rows * S->id) / P->n_workers) / TILE_ROWS * TILE_ROWS;     // bands start on a tile boundary
+    size_t r1 = ((n_rows * (S->id + 1)) / P->n_workers) / TILE_ROWS * TILE_ROWS;
+    if (S->id + 1 == P->n_workers) {
+        r1 = n_rows;
+    }
+    S->res = update_rows(P->G, r0, r1, S->id);
+}
+
+
+static
+void* worker_thread(void* Sv) {
+    worker_slot* S = Sv;
+    worker_pool* P = S->pool;
+    while (true) {
+        pthread_barrier_wait(&P->start);                            // wait for the next generation
+        if (P->quit) {
+            break;
+        }
+        update_band(S);                                             // bands only write to their own rows of G->next,
+        pthread_barrier_wait(&P->done);                             // the halo rows of G->B are shared read-only
+    }
+    return 0;
+}
+
+
+worker_pool* create_pool(size_t n_workers) {
+    worker_pool* P = game_malloc(sizeof(worker_pool));
+    P->n_workers = n_workers;
+    P->threads = game_malloc(n_workers * sizeof(pthread_t));
+    P->slots = game_calloc(n_workers, sizeof(worker_slot));
+    P->G = NULL;
+    P->quit = false;
+    pthread_barrier_init(&P->start, 0, n_workers);
+    pthread_barrier_init(&P->done, 0, n_workers);
+
+    for (size_t k = 0; k < n_workers; k++) {
+        P->slots[k].pool = P;
+        P->slots[k].id = k;
+    }
+    for (size_t k = 1; k < n_workers; k++) {                        // band 0 is handled by the calling thread
+        pthread_create(&P->threads[k], 0, worker_thread, &P->slots[k]);
+    }
+    return P;
+}
+
+
+void destroy_pool(worker_pool* P) {
+    P->quit = true;
+    pthread_barrier_wait(&P->start);                                // wake the workers so they can see quit
+    for (size_t k = 1; k < P->n_workers; k++) {
+        pthread_join(P->threads[k], 0);
+    }
+    pthread_barrier_destroy(&P->start);
+    pthread_barrier_destroy(&P->done);
+    free(P->slots);
+    free(P->threads);
+    free(P);
+}
+
+
+step_result pool_update(worker_pool* P, game_state* G) {
+    P->G = G;
+    pthread_barrier_wait(&P->start);                                // barrier publishes G and the filled-in halo
+    update_band(&P->slots[0]);
+    pthread_barrier_wait(&P->done);
+
+    step_result res = step_init();
+    for (size_t k = 0; k < P->n_workers; k++) {                     // reduce the per-band results
+        step_merge(&res, &P->slots[k].res);
+    }
+    return res;
+}
@@ -0,0 +1,64 @@
+/*
+ -------------------------------------
+ File:    worker_pool.h
+ Project: conway-game-of-life
+ Header for the parallel row-band update engine
+ -------------------------------------
+ Author:  Akshath Wikramanayake
+ Email:   akshath.wikramanayake@gmail.com
+ Version  0.0.1
+ -------------------------------------
+ */
+
+#ifndef WORKER_POOL_H
+#define WORKER_POOL_H
+
+#include <stdlib.h>
+#include <pthread.h>
+#include <stdbool.h>
+
+#include "life_functions.h"
+
+
+typedef struct _worker_slot {
+    struct _worker_pool* pool;  // pool that owns the worker
+    size_t id;                  // band index handled by the worker
+    step_result res;            // changed count, hash update, births and bounds of the worker's band for the last update
+    char pad[64];               // keep the counts of different workers on separate cache lines
+} worker_slot;
+
+
+typedef struct _worker_pool {
+    size_t n_workers;           // # of bands (the thread calling pool_update handles band 0)
+    pthread_t* threads;         // n_workers - 1 persistent worker threads
+    worker_slot* slots;         // per-band state
+    pthread_barrier_t start;    // released when the halo is filled in and a generation can be computed
+    pthread_barrier_t done;     // released when every band of the generation has been written
+    game_state* G;              // game being updated (set by pool_update)
+    bool quit;                  // set to true to make the workers exit
+} worker_pool;
+
+
+/*
+    Creates a pool of persistent workers that split the board into horizontal bands
+    n_workers: # of bands/threads, including the thread that calls pool_update
+    returns: pointer to the new pool
+*/
+worker_pool* create_pool(size_t n_workers);
+
+
+/*
+    Stops and joins the worker threads and deallocates the pool
+*/
+void destroy_pool(worker_pool*);
+
+
+/*
+    Computes the next generation of G into G->next, one row band per worker.
+    The halo of G->B must already be filled in; the caller swaps the boards afterwards.
+    returns: total number of tiles whose life/death status changed (summed over the bands) and the
+    combined board hash update
+*/
+step_result pool_update(worker_pool*, game_state* G);
+
+#endif